@@ -0,0 +1,813 @@
+/**
+ * @file lfds_bench.cpp
+ * @brief Throughput and latency benchmarks for every lfds queue, across payload sizes, batch sizes and core placements
+ * @version 0.1
+ *
+ * For each queue, payload size and core pair, measures:
+ *  - throughput: producer pushes as fast as it can (in batches, where the queue supports them), consumer drains.
+ *    Latency is the time from push to pop for one message in SAMPLE_EVERY, so it includes time spent queued.
+ *  - pingpong: one message at a time bounced between two queues. Latency is half the round trip.
+ *
+ * The consumer runs on a thread pinned with utils::threads::createAndStart(), the producer on the main thread pinned
+ * to the other core of the pair. By default the pairs are picked from the machine's topology: both on one core, SMT
+ * siblings, two cores on one socket, and two sockets - whichever exist.
+ *
+ * Results go to stdout as CSV or JSON, one row per run. Progress goes to stderr.
+ *
+ * Usage: LFDSBench [--messages N] [--capacity N] [--queues spsc,segmented,...] [--payloads 16,64,256]
+ *                  [--batches 1,16,64] [--pairs auto|P:C,...] [--format csv|json]
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <immintrin.h>
+#include "utils/assertions.hpp"
+#include "utils/threads/threads.hpp"
+#include "utils/time.hpp"
+#include "lfds/spscqueue.hpp"
+#include "lfds/segmented_spscqueue.hpp"
+#include "lfds/mpscqueue.hpp"
+#include "lfds/mpmcqueue.hpp"
+#include "lfds/broadcast_ring.hpp"
+#include "lfds/byte_ring.hpp"
+#include "lfds/shm_spscqueue.hpp"
+
+namespace {
+
+    // Throughput runs timestamp one message in this many, so the clock doesn't dominate small payloads
+    constexpr uint64_t SAMPLE_EVERY { 16 };
+
+    // Ping pong runs are one message in flight at a time, so they're capped to keep the run short
+    constexpr size_t MAX_PINGPONG_MESSAGES { 200'000 };
+
+    uint64_t nanos() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()
+        ).count();
+    }
+
+    /**
+     * @brief Message of SIZE bytes. The sequence number lets the consumer check nothing was lost or reordered.
+     */
+    template<size_t SIZE>
+    struct Payload {
+        static_assert(SIZE >= 2 * sizeof(uint64_t), "Payload must fit a sequence number and a timestamp");
+        uint64_t sequence_;
+        uint64_t stamp_;
+        std::array<std::byte, SIZE - 2 * sizeof(uint64_t)> padding_;
+    };
+
+    template<>
+    struct Payload<2 * sizeof(uint64_t)> {
+        uint64_t sequence_;
+        uint64_t stamp_;
+    };
+
+    static_assert(sizeof(Payload<16>) == 16 && sizeof(Payload<64>) == 64 && sizeof(Payload<256>) == 256);
+
+    /*
+     * Every queue is wrapped in an adapter with the same interface, so one set of benchmarks covers them all:
+     *
+     *  - static constexpr const char* NAME
+     *  - static constexpr bool BATCH                  Whether pushBatch()/popBatch() are available
+     *  - explicit Adapter(size_t capacity)
+     *  - bool push(Fill&& fill)                       fill(P&) writes the message in place. false if full.
+     *  - bool pop(Read&& read)                        read(const P&) reads the message in place. false if empty.
+     *  - size_t pushBatch(size_t count, Fill&& fill)  Same, for up to count messages at once
+     *  - size_t popBatch(size_t count, Read&& read)
+     */
+
+    template<typename P>
+    class SPSCAdapter final {
+    private:
+        lfds::SPSCQueue<P> queue_;
+
+    public:
+        static constexpr const char* NAME { "spsc" };
+        static constexpr bool BATCH { true };
+
+        explicit SPSCAdapter(size_t capacity) : queue_ { capacity } {}
+
+        template<typename Fill>
+        bool push(Fill&& fill) {
+            if (queue_.full()) {
+                return false;
+            }
+            fill(*queue_.getNextWriteTo());
+            queue_.updateWriteIndex();
+            return true;
+        }
+
+        template<typename Read>
+        bool pop(Read&& read) {
+            auto next { queue_.getNextRead() };
+            if (!next) {
+                return false;
+            }
+            read(*next);
+            queue_.updateReadIndex();
+            return true;
+        }
+
+        template<typename Fill>
+        size_t pushBatch(size_t count, Fill&& fill) {
+            auto batch { queue_.reserveBatch(count) };
+            for (auto& element : batch) {
+                fill(element);
+            }
+            queue_.commitBatch(batch.size());
+            return batch.size();
+        }
+
+        template<typename Read>
+        size_t popBatch(size_t count, Read&& read) {
+            auto batch { queue_.peekBatch(count) };
+            for (const auto& element : batch) {
+                read(element);
+            }
+            queue_.releaseBatch(batch.size());
+            return batch.size();
+        }
+    };
+
+    template<typename P>
+    class SegmentedAdapter final {
+    private:
+        static constexpr size_t SEGMENT_SIZE { 4096 };
+        lfds::SegmentedSPSCQueue<P, SEGMENT_SIZE> queue_;
+
+    public:
+        static constexpr const char* NAME { "segmented" };
+        static constexpr bool BATCH { true };
+
+        // Same footprint as the bounded queues up front - it only grows if the consumer falls further behind
+        explicit SegmentedAdapter(size_t capacity) : queue_ { std::max<size_t>(capacity / SEGMENT_SIZE, 1) } {}
+
+        template<typename Fill>
+        bool push(Fill&& fill) {
+            fill(*queue_.getNextWriteTo());
+            queue_.updateWriteIndex();
+            return true;
+        }
+
+        template<typename Read>
+        bool pop(Read&& read) {
+            auto next { queue_.getNextRead() };
+            if (!next) {
+                return false;
+            }
+            read(*next);
+            queue_.updateReadIndex();
+            return true;
+        }
+
+        template<typename Fill>
+        size_t pushBatch(size_t count, Fill&& fill) {
+            auto batch { queue_.reserveBatch(count) };
+            for (auto& element : batch) {
+                fill(element);
+            }
+            queue_.commitBatch(batch.size());
+            return batch.size();
+        }
+
+        template<typename Read>
+        size_t popBatch(size_t count, Read&& read) {
+            auto batch { queue_.peekBatch(count) };
+            for (const auto& element : batch) {
+                read(element);
+            }
+            queue_.releaseBatch(batch.size());
+            return batch.size();
+        }
+    };
+
+    template<typename P>
+    class MPSCAdapter final {
+    private:
+        lfds::MPSCQueue<P> queue_;
+
+    public:
+        static constexpr const char* NAME { "mpsc" };
+        static constexpr bool BATCH { false };
+
+        explicit MPSCAdapter(size_t capacity) : queue_ { capacity } {}
+
+        template<typename Fill>
+        bool push(Fill&& fill) {
+            auto next { queue_.getNextWriteTo() };
+            if (!next) {
+                return false;
+            }
+            fill(*next);
+            queue_.updateWriteIndex(next);
+            return true;
+        }
+
+        template<typename Read>
+        bool pop(Read&& read) {
+            auto next { queue_.getNextRead() };
+            if (!next) {
+                return false;
+            }
+            read(*next);
+            queue_.updateReadIndex();
+            return true;
+        }
+
+        template<typename Fill>
+        size_t pushBatch(size_t, Fill&&) { return 0; }
+        template<typename Read>
+        size_t popBatch(size_t, Read&&) { return 0; }
+    };
+
+    template<typename P>
+    class MPMCAdapter final {
+    private:
+        lfds::MPMCQueue<P> queue_;
+        std::vector<P> out_;
+        // Message filled in but not yet accepted by a full queue. Pushed before asking for another one.
+        P staged_;
+        bool has_staged_ { false };
+
+    public:
+        static constexpr const char* NAME { "mpmc" };
+        static constexpr bool BATCH { true };
+
+        explicit MPMCAdapter(size_t capacity) : queue_ { capacity }, out_(capacity) {}
+
+        template<typename Fill>
+        bool push(Fill&& fill) {
+            if (!has_staged_) {
+                fill(staged_);
+                has_staged_ = true;
+            }
+            has_staged_ = !queue_.tryEmplace(staged_);
+            return !has_staged_;
+        }
+
+        template<typename Read>
+        bool pop(Read&& read) {
+            P message;
+            if (!queue_.tryPop(message)) {
+                return false;
+            }
+            read(message);
+            return true;
+        }
+
+        // Producers can only claim one slot at a time
+        template<typename Fill>
+        size_t pushBatch(size_t count, Fill&& fill) {
+            size_t pushed { 0 };
+            while (pushed < count && push(fill)) {
+                ++pushed;
+            }
+            return pushed;
+        }
+
+        template<typename Read>
+        size_t popBatch(size_t count, Read&& read) {
+            const auto popped { queue_.tryPopBatch(out_.data(), std::min(count, out_.size())) };
+            for (size_t i { 0 }; i < popped; ++i) {
+                read(out_[i]);
+            }
+            return popped;
+        }
+    };
+
+    template<typename P>
+    class BroadcastAdapter final {
+    private:
+        lfds::BroadcastRing<P> ring_;
+        typename lfds::BroadcastRing<P>::Consumer& consumer_;
+
+    public:
+        static constexpr const char* NAME { "broadcast" };
+        static constexpr bool BATCH { true };
+
+        explicit BroadcastAdapter(size_t capacity) : ring_ { capacity }, consumer_ { ring_.addConsumer() } {}
+
+        template<typename Fill>
+        bool push(Fill&& fill) {
+            auto next { ring_.getNextWriteTo() };
+            if (!next) {
+                return false;
+            }
+            fill(*next);
+            ring_.updateWriteIndex();
+            return true;
+        }
+
+        template<typename Read>
+        bool pop(Read&& read) {
+            auto next { consumer_.getNextRead() };
+            if (!next) {
+                return false;
+            }
+            read(*next);
+            consumer_.updateReadIndex();
+            return true;
+        }
+
+        // The producer publishes one message at a time
+        template<typename Fill>
+        size_t pushBatch(size_t count, Fill&& fill) {
+            size_t pushed { 0 };
+            while (pushed < count && push(fill)) {
+                ++pushed;
+            }
+            return pushed;
+        }
+
+        template<typename Read>
+        size_t popBatch(size_t count, Read&& read) {
+            auto batch { consumer_.peekBatch(count) };
+            for (const auto& element : batch) {
+                read(element);
+            }
+            consumer_.releaseBatch(batch.size());
+            return batch.size();
+        }
+    };
+
+    template<typename P>
+    class ByteRingAdapter final {
+    private:
+        lfds::ByteRing<> ring_;
+
+    public:
+        static constexpr const char* NAME { "byte_ring" };
+        static constexpr bool BATCH { false };
+
+        // Record headers take up room too, so size the ring for capacity records
+        explicit ByteRingAdapter(size_t capacity) : ring_ { std::bit_ceil(capacity * (sizeof(P) + sizeof(lfds::ByteRecord))) } {}
+
+        template<typename Fill>
+        bool push(Fill&& fill) {
+            auto data { ring_.reserve(sizeof(P)) };
+            if (!data) {
+                return false;
+            }
+            fill(*reinterpret_cast<P*>(data));
+            ring_.commit();
+            return true;
+        }
+
+        template<typename Read>
+        bool pop(Read&& read) {
+            auto record { ring_.peek() };
+            if (!record) {
+                return false;
+            }
+            read(*reinterpret_cast<const P*>(record->data()));
+            ring_.consume();
+            return true;
+        }
+
+        template<typename Fill>
+        size_t pushBatch(size_t, Fill&&) { return 0; }
+        template<typename Read>
+        size_t popBatch(size_t, Read&&) { return 0; }
+    };
+
+    template<typename P>
+    class ShmAdapter final {
+    private:
+        const std::string name_;
+        // Each side maps the segment itself, as separate processes would
+        lfds::ShmSPSCQueue<P> producer_;
+        lfds::ShmSPSCQueue<P> consumer_;
+
+        static std::string uniqueName() {
+            static std::atomic<int> count { 0 };
+            return "/lfds_bench_" + std::to_string(getpid()) + "_" + std::to_string(count++);
+        }
+
+    public:
+        static constexpr const char* NAME { "shm_spsc" };
+        static constexpr bool BATCH { false };
+
+        explicit ShmAdapter(size_t capacity)
+            : name_ { uniqueName() }, producer_ { name_, lfds::ShmRole::CREATOR, std::bit_ceil(capacity) },
+              consumer_ { name_, lfds::ShmRole::ATTACHER, std::bit_ceil(capacity) }
+        {}
+
+        ~ShmAdapter() {
+            lfds::ShmSPSCQueue<P>::remove(name_);
+        }
+
+        template<typename Fill>
+        bool push(Fill&& fill) {
+            if (producer_.full()) {
+                return false;
+            }
+            fill(*producer_.getNextWriteTo());
+            producer_.updateWriteIndex();
+            return true;
+        }
+
+        template<typename Read>
+        bool pop(Read&& read) {
+            auto next { consumer_.getNextRead() };
+            if (!next) {
+                return false;
+            }
+            read(*next);
+            consumer_.updateReadIndex();
+            return true;
+        }
+
+        template<typename Fill>
+        size_t pushBatch(size_t, Fill&&) { return 0; }
+        template<typename Read>
+        size_t popBatch(size_t, Read&&) { return 0; }
+    };
+
+    /**
+     * @brief Two cores to run the producer and consumer on, and what they share
+     */
+    struct CorePair {
+        std::string label_;
+        int producer_core_;
+        int consumer_core_;
+    };
+
+    struct Options {
+        size_t messages_ { 1'000'000 };
+        size_t capacity_ { 65536 };
+        std::vector<std::string> queues_ { "spsc", "segmented", "mpsc", "mpmc", "broadcast", "byte_ring", "shm_spsc" };
+        std::vector<size_t> payloads_ { 16, 64, 256 };
+        std::vector<size_t> batches_ { 1, 16, 64 };
+        std::vector<CorePair> pairs_;
+        bool json_ { false };
+    };
+
+    struct Result {
+        std::string queue_;
+        size_t payload_;
+        size_t batch_;
+        CorePair pair_;
+        std::string mode_;
+        size_t messages_;
+        double seconds_;
+        uint64_t p50_ns_, p99_ns_, p999_ns_, max_ns_;
+    };
+
+    /**
+     * @brief What a thread does while it waits on the queue. When both threads share a core, the other one can only
+     * make progress if we give the core up.
+     */
+    inline void relax(bool same_core) noexcept {
+        if (same_core) {
+            std::this_thread::yield();
+        } else {
+            _mm_pause();
+        }
+    }
+
+    /**
+     * @brief Consumer thread, pinned once per core pair and handed one run at a time.
+     */
+    class Worker final {
+    private:
+        const bool same_core_;
+        std::atomic<std::function<void()>*> job_ { nullptr };
+        std::atomic<bool> stopping_ { false };
+        // createAndStart() runs the function by reference, so it has to live as long as the thread
+        const std::function<void()> body_ { [this]() { loop(); } };
+        std::thread thread_;
+
+    public:
+        Worker(int core, bool same_core)
+            : same_core_ { same_core }
+        {
+            // createAndStart() reports on stdout, which is for results only
+            const auto stdout_buffer { std::cout.rdbuf(std::cerr.rdbuf()) };
+            thread_ = utils::threads::createAndStart(core, "LFDSBench consumer", body_);
+            std::cout.rdbuf(stdout_buffer);
+            utils::ASSERT(thread_.joinable(), "Failed to start consumer on core " + std::to_string(core));
+        }
+
+        ~Worker() {
+            stopping_ = true;
+            thread_.join();
+        }
+
+        Worker(const Worker&) = delete;
+        Worker& operator=(const Worker&) = delete;
+
+        void start(std::function<void()>& job) noexcept {
+            job_.store(&job, std::memory_order_release);
+        }
+
+        void wait() const noexcept {
+            while (job_.load(std::memory_order_acquire)) {
+                relax(same_core_);
+            }
+        }
+
+    private:
+        void loop() noexcept {
+            while (!stopping_.load(std::memory_order_relaxed)) {
+                if (auto job { job_.load(std::memory_order_acquire) }) {
+                    (*job)();
+                    job_.store(nullptr, std::memory_order_release);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    };
+
+    void percentiles(std::vector<uint64_t>& samples, Result& result) {
+        if (samples.empty()) {
+            result.p50_ns_ = result.p99_ns_ = result.p999_ns_ = result.max_ns_ = 0;
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        const auto at { [&samples](double quantile) { return samples[static_cast<size_t>(quantile * (samples.size() - 1))]; } };
+        result.p50_ns_ = at(0.5);
+        result.p99_ns_ = at(0.99);
+        result.p999_ns_ = at(0.999);
+        result.max_ns_ = samples.back();
+    }
+
+    template<typename Queue, typename P>
+    Result runThroughput(const Options& options, const CorePair& pair, Worker& worker, size_t batch) {
+        const bool same_core { pair.producer_core_ == pair.consumer_core_ };
+        const auto messages { options.messages_ };
+        Queue queue { options.capacity_ };
+        std::vector<uint64_t> samples;
+        samples.reserve(messages / SAMPLE_EVERY + 1);
+        uint64_t end { 0 };
+
+        std::function<void()> consume { [&]() {
+            uint64_t expected { 0 };
+            const auto read { [&](const P& message) {
+                if (message.sequence_ != expected++) [[unlikely]] {
+                    utils::FATAL(std::string { "Message lost or reordered by " } + Queue::NAME);
+                }
+                if (message.stamp_) {
+                    samples.push_back(nanos() - message.stamp_);
+                }
+            } };
+            while (expected < messages) {
+                const bool got { Queue::BATCH && batch > 1 ? queue.popBatch(std::min(batch, messages - expected), read) > 0 : queue.pop(read) };
+                if (!got) {
+                    relax(same_core);
+                }
+            }
+            end = nanos();
+        } };
+        worker.start(consume);
+
+        uint64_t sequence { 0 };
+        const auto fill { [&sequence](P& message) {
+            message.sequence_ = sequence;
+            message.stamp_ = sequence % SAMPLE_EVERY ? 0 : nanos();
+            ++sequence;
+        } };
+        const auto start { nanos() };
+        while (sequence < messages) {
+            const bool pushed { Queue::BATCH && batch > 1 ? queue.pushBatch(std::min(batch, messages - sequence), fill) > 0 : queue.push(fill) };
+            if (!pushed) {
+                relax(same_core);
+            }
+        }
+        worker.wait();
+
+        Result result { Queue::NAME, sizeof(P), Queue::BATCH ? batch : 1, pair, "throughput", messages,
+            static_cast<double>(end - start) / utils::NANOS_TO_SECS, 0, 0, 0, 0 };
+        percentiles(samples, result);
+        return result;
+    }
+
+    template<typename Queue, typename P>
+    Result runPingPong(const Options& options, const CorePair& pair, Worker& worker) {
+        const bool same_core { pair.producer_core_ == pair.consumer_core_ };
+        const auto messages { std::min(options.messages_, MAX_PINGPONG_MESSAGES) };
+        Queue ping { options.capacity_ };
+        Queue pong { options.capacity_ };
+
+        std::function<void()> echo { [&]() {
+            for (size_t i { 0 }; i < messages; ++i) {
+                P message;
+                while (!ping.pop([&message](const P& received) { message = received; })) {
+                    relax(same_core);
+                }
+                while (!pong.push([&message](P& reply) { reply = message; })) {
+                    relax(same_core);
+                }
+            }
+        } };
+        worker.start(echo);
+
+        std::vector<uint64_t> samples;
+        samples.reserve(messages);
+        const auto start { nanos() };
+        for (size_t i { 0 }; i < messages; ++i) {
+            const auto sent { nanos() };
+            while (!ping.push([i, sent](P& message) { message.sequence_ = i; message.stamp_ = sent; })) {
+                relax(same_core);
+            }
+            while (!pong.pop([](const P&) {})) {
+                relax(same_core);
+            }
+            samples.push_back((nanos() - sent) / 2);
+        }
+        const auto end { nanos() };
+        worker.wait();
+
+        Result result { Queue::NAME, sizeof(P), 1, pair, "pingpong", messages,
+            static_cast<double>(end - start) / utils::NANOS_TO_SECS, 0, 0, 0, 0 };
+        percentiles(samples, result);
+        return result;
+    }
+
+    template<template<typename> typename Adapter, typename P>
+    void benchPayload(const Options& options, const CorePair& pair, Worker& worker, std::vector<Result>& results) {
+        using Queue = Adapter<P>;
+        if (std::find(options.payloads_.begin(), options.payloads_.end(), sizeof(P)) == options.payloads_.end()) {
+            return;
+        }
+        for (auto batch : options.batches_) {
+            if (batch > 1 && !Queue::BATCH) {
+                continue;
+            }
+            std::cerr << Queue::NAME << " payload=" << sizeof(P) << " batch=" << batch << " pair=" << pair.label_ << std::endl;
+            results.push_back(runThroughput<Queue, P>(options, pair, worker, batch));
+        }
+        std::cerr << Queue::NAME << " payload=" << sizeof(P) << " pingpong pair=" << pair.label_ << std::endl;
+        results.push_back(runPingPong<Queue, P>(options, pair, worker));
+    }
+
+    template<template<typename> typename Adapter>
+    void benchQueue(const Options& options, const CorePair& pair, Worker& worker, std::vector<Result>& results) {
+        if (std::find(options.queues_.begin(), options.queues_.end(), Adapter<Payload<16>>::NAME) == options.queues_.end()) {
+            return;
+        }
+        benchPayload<Adapter, Payload<16>>(options, pair, worker, results);
+        benchPayload<Adapter, Payload<64>>(options, pair, worker, results);
+        benchPayload<Adapter, Payload<256>>(options, pair, worker, results);
+    }
+
+    int readTopology(int cpu, const std::string& field) {
+        std::ifstream file { "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + field };
+        int value { -1 };
+        file >> value;
+        return value;
+    }
+
+    /**
+     * @brief Pick a core pair for each kind of placement this machine has, all relative to core 0.
+     */
+    std::vector<CorePair> detectPairs() {
+        std::vector<CorePair> pairs { { "same-core", 0, 0 } };
+        const int cpus { static_cast<int>(std::thread::hardware_concurrency()) };
+        const auto core { readTopology(0, "core_id") };
+        const auto package { readTopology(0, "physical_package_id") };
+
+        int sibling { -1 }, other_core { -1 }, other_socket { -1 };
+        for (int cpu { 1 }; cpu < cpus; ++cpu) {
+            const auto cpu_core { readTopology(cpu, "core_id") };
+            const auto cpu_package { readTopology(cpu, "physical_package_id") };
+            if (cpu_package != package) {
+                other_socket = other_socket < 0 ? cpu : other_socket;
+            } else if (cpu_core == core) {
+                sibling = sibling < 0 ? cpu : sibling;
+            } else {
+                other_core = other_core < 0 ? cpu : other_core;
+            }
+        }
+        if (sibling > 0) {
+            pairs.push_back({ "smt-sibling", 0, sibling });
+        }
+        if (other_core > 0) {
+            pairs.push_back({ "cross-core", 0, other_core });
+        }
+        if (other_socket > 0) {
+            pairs.push_back({ "cross-socket", 0, other_socket });
+        }
+        return pairs;
+    }
+
+    template<typename T, typename Parse>
+    std::vector<T> parseList(const std::string& list, Parse&& parse) {
+        std::vector<T> values;
+        std::stringstream stream { list };
+        for (std::string item; std::getline(stream, item, ',');) {
+            values.push_back(parse(item));
+        }
+        return values;
+    }
+
+    Options parseOptions(int argc, char** argv) {
+        Options options;
+        std::string pairs { "auto" };
+        for (int i { 1 }; i < argc; ++i) {
+            const std::string arg { argv[i] };
+            utils::ASSERT(arg == "--help" || i + 1 < argc, "Missing value for " + arg);
+            if (arg == "--messages") {
+                options.messages_ = std::stoul(argv[++i]);
+            } else if (arg == "--capacity") {
+                options.capacity_ = std::stoul(argv[++i]);
+            } else if (arg == "--queues") {
+                options.queues_ = parseList<std::string>(argv[++i], [](const std::string& item) { return item; });
+            } else if (arg == "--payloads") {
+                options.payloads_ = parseList<size_t>(argv[++i], [](const std::string& item) { return std::stoul(item); });
+            } else if (arg == "--batches") {
+                options.batches_ = parseList<size_t>(argv[++i], [](const std::string& item) { return std::stoul(item); });
+            } else if (arg == "--pairs") {
+                pairs = argv[++i];
+            } else if (arg == "--format") {
+                const std::string format { argv[++i] };
+                utils::ASSERT(format == "csv" || format == "json", "Format must be csv or json");
+                options.json_ = format == "json";
+            } else {
+                std::cerr << "Usage: LFDSBench [--messages N] [--capacity N] [--queues spsc,segmented,mpsc,mpmc,broadcast,byte_ring,shm_spsc]\n"
+                             "                 [--payloads 16,64,256] [--batches 1,16,64] [--pairs auto|P:C,...] [--format csv|json]" << std::endl;
+                std::exit(arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+        }
+
+        if (pairs == "auto") {
+            options.pairs_ = detectPairs();
+        } else {
+            options.pairs_ = parseList<CorePair>(pairs, [](const std::string& item) {
+                const auto colon { item.find(':') };
+                utils::ASSERT(colon != std::string::npos, "Core pairs are given as producer:consumer");
+                const auto producer { std::stoi(item.substr(0, colon)) };
+                const auto consumer { std::stoi(item.substr(colon + 1)) };
+                return CorePair { item, producer, consumer };
+            });
+        }
+        return options;
+    }
+
+    void printCsv(const std::vector<Result>& results) {
+        std::cout << "queue,payload_bytes,batch,pair,producer_core,consumer_core,mode,messages,seconds,msgs_per_sec,p50_ns,p99_ns,p999_ns,max_ns\n";
+        for (const auto& result : results) {
+            std::cout << result.queue_ << ',' << result.payload_ << ',' << result.batch_ << ',' << result.pair_.label_ << ','
+                << result.pair_.producer_core_ << ',' << result.pair_.consumer_core_ << ',' << result.mode_ << ','
+                << result.messages_ << ',' << result.seconds_ << ',' << static_cast<uint64_t>(result.messages_ / result.seconds_) << ','
+                << result.p50_ns_ << ',' << result.p99_ns_ << ',' << result.p999_ns_ << ',' << result.max_ns_ << '\n';
+        }
+    }
+
+    void printJson(const std::vector<Result>& results) {
+        std::cout << "[\n";
+        for (size_t i { 0 }; i < results.size(); ++i) {
+            const auto& result { results[i] };
+            std::cout << "  {\"queue\": \"" << result.queue_ << "\", \"payload_bytes\": " << result.payload_
+                << ", \"batch\": " << result.batch_ << ", \"pair\": \"" << result.pair_.label_
+                << "\", \"producer_core\": " << result.pair_.producer_core_ << ", \"consumer_core\": " << result.pair_.consumer_core_
+                << ", \"mode\": \"" << result.mode_ << "\", \"messages\": " << result.messages_ << ", \"seconds\": " << result.seconds_
+                << ", \"msgs_per_sec\": " << static_cast<uint64_t>(result.messages_ / result.seconds_)
+                << ", \"p50_ns\": " << result.p50_ns_ << ", \"p99_ns\": " << result.p99_ns_
+                << ", \"p999_ns\": " << result.p999_ns_ << ", \"max_ns\": " << result.max_ns_ << '}'
+                << (i + 1 < results.size() ? "," : "") << '\n';
+        }
+        std::cout << "]\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto options { parseOptions(argc, argv) };
+
+    std::vector<Result> results;
+    for (const auto& pair : options.pairs_) {
+        utils::ASSERT(utils::threads::setThreadCore(pair.producer_core_), "Failed to pin producer to core " + std::to_string(pair.producer_core_));
+        Worker worker { pair.consumer_core_, pair.producer_core_ == pair.consumer_core_ };
+
+        benchQueue<SPSCAdapter>(options, pair, worker, results);
+        benchQueue<SegmentedAdapter>(options, pair, worker, results);
+        benchQueue<MPSCAdapter>(options, pair, worker, results);
+        benchQueue<MPMCAdapter>(options, pair, worker, results);
+        benchQueue<BroadcastAdapter>(options, pair, worker, results);
+        benchQueue<ByteRingAdapter>(options, pair, worker, results);
+        benchQueue<ShmAdapter>(options, pair, worker, results);
+    }
+
+    if (options.json_) {
+        printJson(results);
+    } else {
+        printCsv(results);
+    }
+}
@@ -0,0 +1,325 @@
+#pragma once
+/**
+ * @file broadcast_ring.hpp
+ * @brief Single producer, multiple consumer ring where every consumer sees every message (disruptor style)
+ * @version 0.1
+ * @test tests/lfds/test_broadcast_ring.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief What the producer does when it laps the slowest consumer
+     */
+    enum class BroadcastOverflow {
+        // Producer can't write until every consumer has read the slot it wants to reuse
+        GATE,
+        // Producer never waits. Consumers that fall more than a lap behind skip ahead, and count what they lost.
+        OVERWRITE,
+    };
+
+    /**
+     * @brief Ring buffer that one producer writes to and any number of consumers read from, where each consumer
+     * has its own cursor and sees every message - one copy of each message, however many consumers there are.
+     *
+     * Consumers can depend on other consumers: a consumer only sees a message once all of its dependencies have
+     * finished with it. So e.g. a recorder can persist a message before a strategy acts on it, or one stage can fill in
+     * a field that the next stage reads, without any extra queues.
+     *
+     * All consumers must be added with addConsumer() before the producer starts writing.
+     *
+     * @tparam T Type of message. Must be trivially copyable in OVERWRITE mode, as consumers may read a slot while
+     * the producer is overwriting it (the read is then thrown away).
+     * @tparam N Capacity, fixed at compile time (must be a power of two), or utils::DYNAMIC_CAPACITY to
+     * allocate storage at construction.
+     * @tparam Overflow What the producer does when it catches up with the slowest consumer.
+     */
+    template<typename T, size_t N = utils::DYNAMIC_CAPACITY, BroadcastOverflow Overflow = BroadcastOverflow::GATE>
+    class BroadcastRing final {
+    private:
+        static constexpr bool IS_STATIC { N != utils::DYNAMIC_CAPACITY };
+        static constexpr bool IS_OVERWRITE { Overflow == BroadcastOverflow::OVERWRITE };
+        static_assert(!IS_STATIC || std::has_single_bit(N), "BroadcastRing capacity must be a power of two");
+        static_assert(!IS_OVERWRITE || std::is_trivially_copyable_v<T>, "Overwriting BroadcastRing elements must be trivially copyable");
+
+    public:
+        /**
+         * @brief One reader of the ring. Each consumer must only be used from one thread.
+         */
+        class alignas(utils::CACHE_LINE_SIZE) Consumer final {
+        private:
+            friend class BroadcastRing;
+
+            BroadcastRing& ring_;
+
+            // Consumers that must have finished with a message before this one sees it
+            const std::vector<const Consumer*> dependencies_;
+
+            // Next sequence to read. Written by this consumer only, read by the producer and by dependent consumers.
+            alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_read_index_ { 0 };
+
+            // Last seen upper bound of what this consumer can read. Only refreshed when everything below it has been read.
+            size_t cached_available_ { 0 };
+
+            // Messages that were overwritten before this consumer got to them (OVERWRITE mode)
+            std::atomic<size_t> lost_ { 0 };
+
+        public:
+            Consumer(BroadcastRing& ring, std::initializer_list<const Consumer*> dependencies)
+                : ring_ { ring }, dependencies_ { dependencies }
+            {}
+
+            Consumer(const Consumer&) = delete;
+            Consumer& operator=(const Consumer&) = delete;
+
+            /**
+             * @brief Get a pointer to the next message for this consumer. The message can be modified, for the benefit
+             * of consumers that depend on this one.
+             * @note Remember to call updateReadIndex() after reading!
+             * @return T* or nullptr if there is nothing to read yet
+             */
+            T* getNextRead() noexcept requires (!IS_OVERWRITE) {
+                const auto read { next_read_index_.load(std::memory_order_relaxed) };
+                if (read == cached_available_) {
+                    cached_available_ = ring_.availableFor(*this);
+                    if (read == cached_available_) {
+                        return nullptr;
+                    }
+                }
+                return &ring_.data_[ring_.index(read)];
+            }
+
+            /**
+             * @brief Mark the current message as done with, releasing it to dependent consumers and the producer.
+             */
+            void updateReadIndex() noexcept requires (!IS_OVERWRITE) {
+                releaseBatch(1);
+            }
+
+            /**
+             * @brief Get up to max_count messages in one go. Stops at the end of the ring, same as SPSCQueue::peekBatch().
+             * @return std::span<T> messages that can be read, empty if there are none
+             */
+            std::span<T> peekBatch(size_t max_count = SIZE_MAX) noexcept requires (!IS_OVERWRITE) {
+                const auto read { next_read_index_.load(std::memory_order_relaxed) };
+                if (cached_available_ - read < max_count) {
+                    cached_available_ = ring_.availableFor(*this);
+                }
+                const auto start { ring_.index(read) };
+                return { &ring_.data_[start], std::min({ max_count, cached_available_ - read, ring_.capacity() - start }) };
+            }
+
+            /**
+             * @brief Mark the first count messages returned by peekBatch() as done with, with a single cursor update.
+             */
+            void releaseBatch(size_t count) noexcept requires (!IS_OVERWRITE) {
+                const auto read { next_read_index_.load(std::memory_order_relaxed) };
+                if (count > cached_available_ - read) [[unlikely]] {
+                    cached_available_ = ring_.availableFor(*this);
+                }
+                if (count > cached_available_ - read) [[unlikely]] {
+                    utils::FATAL("Attempted to release more messages than were read!");
+                }
+                next_read_index_.store(read + count, std::memory_order_release);
+            }
+
+            /**
+             * @brief Copy the next message for this consumer out of the ring. If the consumer has fallen a lap behind,
+             * it skips ahead to the oldest message that hasn't been overwritten, adding what it skipped to lost().
+             * @param out Message is copied into here
+             * @return true if a message was read, false if there is nothing to read yet
+             */
+            bool tryRead(T& out) noexcept requires IS_OVERWRITE {
+                auto read { next_read_index_.load(std::memory_order_relaxed) };
+                while (true) {
+                    const auto published { ring_.next_write_index_.load(std::memory_order_acquire) };
+                    if (read == std::min(published, ring_.availableFor(*this))) {
+                        // Keep any skip ahead from a previous iteration
+                        next_read_index_.store(read, std::memory_order_release);
+                        return false;
+                    }
+
+                    // The producer is writing the slot for published, which holds published - capacity. Anything at or
+                    // before that is gone.
+                    if (published - read >= ring_.capacity()) [[unlikely]] {
+                        const auto oldest { published - ring_.capacity() + 1 };
+                        lost_.store(lost_.load(std::memory_order_relaxed) + (oldest - read), std::memory_order_relaxed);
+                        read = oldest;
+                    }
+
+                    std::memcpy(&out, &ring_.data_[ring_.index(read)], sizeof(T));
+                    // Copy must be complete before checking whether the producer got to the slot while we were copying
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (ring_.next_write_index_.load(std::memory_order_relaxed) - read < ring_.capacity()) [[likely]] {
+                        next_read_index_.store(read + 1, std::memory_order_release);
+                        return true;
+                    }
+                    // Overwritten mid copy, lost that one too
+                    lost_.store(lost_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    ++read;
+                }
+            }
+
+            /**
+             * @brief Number of messages this consumer never saw because the producer overwrote them first.
+             * @note Can be read from any thread.
+             */
+            size_t lost() const noexcept {
+                return lost_.load(std::memory_order_relaxed);
+            }
+
+            /**
+             * @brief Sequence number of the next message this consumer will read (the number it has finished with).
+             */
+            size_t position() const noexcept {
+                return next_read_index_.load(std::memory_order_acquire);
+            }
+        };
+
+    private:
+        std::conditional_t<IS_STATIC, std::array<T, N>, std::vector<T>> data_{};
+
+        std::vector<std::unique_ptr<Consumer>> consumers_;
+
+        // Consumers the producer has to wait for in GATE mode - the ones at the end of each dependency chain.
+        // Everything upstream of them is at least as far along.
+        std::vector<const Consumer*> gating_consumers_;
+
+        // Next sequence to write to. Written by producer only.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_write_index_ { 0 };
+
+        // Producer's last seen position of the slowest gating consumer
+        size_t cached_gate_index_ { 0 };
+
+    public:
+        /**
+         * @brief Create new broadcast ring, with given size and all elements default constructed
+         * @param size Number of elements to dynamically allocate
+         */
+        explicit BroadcastRing(std::size_t size) requires (!IS_STATIC)
+            : data_(size, T())
+        {}
+
+        /**
+         * @brief Create new broadcast ring with compile time capacity, all elements default constructed.
+         */
+        BroadcastRing() requires IS_STATIC = default;
+
+        // Delete copy, move ctors and assignment operators
+        BroadcastRing(const BroadcastRing&) = delete;
+        BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+        BroadcastRing(BroadcastRing&&) = delete;
+        BroadcastRing& operator=(BroadcastRing&&) = delete;
+
+        /**
+         * @brief Add a consumer, that starts at the next message to be written.
+         * @note Not thread safe - add all consumers before the producer starts.
+         * @param dependencies Consumers that must finish with each message before this one sees it
+         * @return Consumer& handle for the new consumer, valid for the lifetime of the ring
+         */
+        Consumer& addConsumer(std::initializer_list<const Consumer*> dependencies = {}) {
+            auto& consumer { *consumers_.emplace_back(std::make_unique<Consumer>(*this, dependencies)) };
+            const auto start { next_write_index_.load(std::memory_order_relaxed) };
+            consumer.next_read_index_.store(start, std::memory_order_relaxed);
+            consumer.cached_available_ = start;
+
+            // A consumer that something now depends on no longer needs to gate the producer
+            gating_consumers_.push_back(&consumer);
+            for (auto dependency : dependencies) {
+                gating_consumers_.erase(std::remove(gating_consumers_.begin(), gating_consumers_.end(), dependency), gating_consumers_.end());
+            }
+            cached_gate_index_ = start;
+            return consumer;
+        }
+
+        /**
+         * @brief Number of messages the ring can hold
+         */
+        constexpr size_t capacity() const noexcept {
+            if constexpr (IS_STATIC) {
+                return N;
+            } else {
+                return data_.size();
+            }
+        }
+
+        /**
+         * @brief Get a pointer to the next message to write to.
+         * @note Remember to call updateWriteIndex() after writing!
+         * @return T* pointer to the message, or nullptr in GATE mode if the slowest consumer is a whole lap behind.
+         */
+        T* getNextWriteTo() noexcept {
+            const auto write { next_write_index_.load(std::memory_order_relaxed) };
+            if constexpr (!IS_OVERWRITE) {
+                if (write - cached_gate_index_ >= capacity()) {
+                    cached_gate_index_ = slowestGatingPosition(write);
+                    if (write - cached_gate_index_ >= capacity()) {
+                        return nullptr;
+                    }
+                }
+            } else {
+                // The slot still holds a message consumers may be copying. Publishing write (the last
+                // updateWriteIndex()) must be seen before any part of the new message, or a consumer could copy a
+                // half overwritten slot and still pass its lap check - as in SeqLock::store().
+                std::atomic_thread_fence(std::memory_order_release);
+            }
+            return &data_[index(write)];
+        }
+
+        /**
+         * @brief Publish the message written to getNextWriteTo() to all consumers.
+         */
+        void updateWriteIndex() noexcept {
+            next_write_index_.store(next_write_index_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+    private:
+        /**
+         * @brief Map a sequence number to the slot it refers to
+         */
+        size_t index(size_t sequence) const noexcept {
+            if constexpr (IS_STATIC) {
+                return sequence & (N - 1);
+            } else {
+                return sequence % data_.size();
+            }
+        }
+
+        /**
+         * @brief Upper bound (exclusive) of what a consumer can read: published, and finished by all of its dependencies.
+         */
+        size_t availableFor(const Consumer& consumer) const noexcept {
+            auto available { next_write_index_.load(std::memory_order_acquire) };
+            for (auto dependency : consumer.dependencies_) {
+                available = std::min(available, dependency->next_read_index_.load(std::memory_order_acquire));
+            }
+            return available;
+        }
+
+        size_t slowestGatingPosition(size_t write) const noexcept {
+            auto slowest { write };
+            for (auto consumer : gating_consumers_) {
+                slowest = std::min(slowest, consumer->next_read_index_.load(std::memory_order_acquire));
+            }
+            return slowest;
+        }
+    };
+}
@@ -0,0 +1,276 @@
+#pragma once
+/**
+ * @file byte_ring.hpp
+ * @brief Single producer, single consumer, lock free ring of variable length byte records
+ * @version 0.1
+ * @test tests/lfds/test_byte_ring.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <type_traits>
+#include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief Header in front of every record in a ByteRing. The payload follows it directly.
+     */
+    struct ByteRecord {
+        // Payload length in bytes, not including this header or padding
+        uint32_t size_;
+        // Free for the user to say what's in the payload, e.g. a message type
+        uint32_t type_;
+
+        std::byte* data() noexcept {
+            return reinterpret_cast<std::byte*>(this + 1);
+        }
+
+        std::span<std::byte> payload() noexcept {
+            return { data(), size_ };
+        }
+    };
+
+    /**
+     * @brief Lock free single producer/consumer ring that stores records of any length back to back, each one
+     * prefixed with a ByteRecord header, rather than one fixed size element per slot like SPSCQueue.
+     * Small messages only take up as much of the ring (and of the memory bandwidth) as they need, and messages of
+     * different types can share a ring without being padded to the largest one.
+     *
+     * Records start on an 8 byte boundary. A record never wraps around the end of the ring: if it doesn't fit in what's
+     * left, the producer fills the rest with a padding record (which the consumer skips) and starts again at the front.
+     * Both sides work on the ring in place, no copying.
+     *
+     * Cursors are byte offsets, and are kept and cached the same way as SPSCQueue's.
+     *
+     * @tparam N Capacity in bytes, fixed at compile time (must be a power of two), or utils::DYNAMIC_CAPACITY to
+     * allocate storage at construction.
+     */
+    template<size_t N = utils::DYNAMIC_CAPACITY>
+    class ByteRing final {
+    private:
+        static constexpr bool IS_STATIC { N != utils::DYNAMIC_CAPACITY };
+        static constexpr size_t RECORD_ALIGNMENT { alignof(uint64_t) };
+        static constexpr uint32_t PADDING_TYPE { UINT32_MAX };
+
+        static_assert(sizeof(ByteRecord) == RECORD_ALIGNMENT);
+        static_assert(!IS_STATIC || (std::has_single_bit(N) && N >= 2 * sizeof(ByteRecord)), "ByteRing capacity must be a power of two");
+
+        alignas(RECORD_ALIGNMENT) std::conditional_t<IS_STATIC, std::array<std::byte, N>, std::vector<std::byte>> data_{};
+
+        // Next byte offset to write a record at. Written by producer only.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_write_index_ {0};
+
+        // Producer's last seen value of next_read_index_. Only refreshed when the ring looks full.
+        size_t cached_read_index_ {0};
+
+        // Where the record handed out by reserve() starts (after any padding), and how much space it takes up
+        size_t reserved_index_ {0};
+        size_t reserved_bytes_ {0};
+
+        // Next byte offset to read a record from. Written by consumer only.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_read_index_ {0};
+
+        // Consumer's last seen value of next_write_index_. Only refreshed when the ring looks empty.
+        size_t cached_write_index_ {0};
+
+    public:
+        /**
+         * @brief Create new byte ring, dynamically allocating its storage
+         * @param capacity Size of the ring in bytes. Must be a power of two.
+         */
+        explicit ByteRing(std::size_t capacity) requires (!IS_STATIC)
+            : data_(capacity)
+        {
+            utils::ASSERT(std::has_single_bit(capacity) && capacity >= 2 * sizeof(ByteRecord), "ByteRing capacity must be a power of two");
+        }
+
+        /**
+         * @brief Create new byte ring with compile time capacity.
+         * @note Storage is inline, so think twice before putting a large ring on the stack.
+         */
+        ByteRing() requires IS_STATIC = default;
+
+        // Delete copy, move ctors and assignment operators
+        ByteRing(const ByteRing&) = delete;
+        ByteRing& operator=(const ByteRing&) = delete;
+
+        ByteRing(ByteRing&&) = delete;
+        ByteRing& operator=(ByteRing&&) = delete;
+
+        /**
+         * @brief Size of the ring in bytes
+         */
+        constexpr size_t capacity() const noexcept {
+            if constexpr (IS_STATIC) {
+                return N;
+            } else {
+                return data_.size();
+            }
+        }
+
+        /**
+         * @brief Largest payload a single record can have. Keeping records to at most half the ring guarantees that
+         * a record always fits, either in what's left at the end or at the front, once the consumer has caught up.
+         */
+        constexpr size_t maxRecordSize() const noexcept {
+            return capacity() / 2 - sizeof(ByteRecord);
+        }
+
+        /**
+         * @brief Number of bytes in use, including record headers and padding.
+         * @note Snapshot only, keep it off the hot path.
+         */
+        size_t bytesUsed() const noexcept {
+            const auto read { next_read_index_.load(std::memory_order_acquire) };
+            const auto write { next_write_index_.load(std::memory_order_acquire) };
+            return write - read;
+        }
+
+        /**
+         * @brief Reserve space for a record in the ring, to be written in place.
+         * @note Remember to call commit() after writing! Producer side only.
+         * @param size Payload length in bytes
+         * @param type Stored in the record header for the consumer
+         * @return std::byte* where to write the payload, or nullptr if there isn't room for the record right now
+         */
+        std::byte* reserve(size_t size, uint32_t type = 0) noexcept {
+            if (size > maxRecordSize() || type == PADDING_TYPE) [[unlikely]] {
+                utils::FATAL("Attempted to reserve an invalid ByteRing record!");
+            }
+
+            const auto write { next_write_index_.load(std::memory_order_relaxed) };
+            const auto record_bytes { recordBytes(size) };
+            const auto to_end { capacity() - offset(write) };
+            // Not enough room before the end of the ring means padding out to the end first
+            const auto padding { record_bytes > to_end ? to_end : 0 };
+
+            if (!hasRoom(write, padding + record_bytes)) {
+                return nullptr;
+            }
+
+            if (padding) {
+                ::new (&data_[offset(write)]) ByteRecord { static_cast<uint32_t>(padding - sizeof(ByteRecord)), PADDING_TYPE };
+            }
+            reserved_index_ = write + padding;
+            reserved_bytes_ = padding + record_bytes;
+            auto record { ::new (&data_[offset(reserved_index_)]) ByteRecord { static_cast<uint32_t>(size), type } };
+            return record->data();
+        }
+
+        /**
+         * @brief Publish the record written to reserve() to the consumer.
+         */
+        void commit() noexcept {
+            if (!reserved_bytes_) [[unlikely]] {
+                utils::FATAL("Attempted to commit a ByteRing record that wasn't reserved!");
+            }
+            next_write_index_.store(next_write_index_.load(std::memory_order_relaxed) + reserved_bytes_, std::memory_order_release);
+            reserved_bytes_ = 0;
+        }
+
+        /**
+         * @brief Publish the record written to reserve(), shrunk to the size that was actually written.
+         * Lets a producer reserve for the largest message it might write and only use what it needs.
+         * @param size Payload length actually written, no more than what was reserved
+         */
+        void commit(size_t size) noexcept {
+            auto record { recordAt(reserved_index_) };
+            if (!reserved_bytes_ || size > record->size_) [[unlikely]] {
+                utils::FATAL("Attempted to commit more than was reserved in ByteRing!");
+            }
+            reserved_bytes_ -= recordBytes(record->size_) - recordBytes(size);
+            record->size_ = static_cast<uint32_t>(size);
+            commit();
+        }
+
+        /**
+         * @brief Copy a payload into a new record.
+         * @return true if written, false if there wasn't room
+         */
+        bool tryWrite(const void* payload, size_t size, uint32_t type = 0) noexcept {
+            auto data { reserve(size, type) };
+            if (!data) {
+                return false;
+            }
+            std::memcpy(data, payload, size);
+            commit();
+            return true;
+        }
+
+        /**
+         * @brief Get the next record to be read, in place.
+         * @note Remember to call consume() after reading! Consumer side only.
+         * @return ByteRecord* or nullptr if there is nothing to read
+         */
+        ByteRecord* peek() noexcept {
+            auto read { next_read_index_.load(std::memory_order_relaxed) };
+            if (!hasUnread(read)) {
+                return nullptr;
+            }
+
+            auto record { recordAt(read) };
+            if (record->type_ == PADDING_TYPE) {
+                // Skip to the front of the ring. The producer always publishes the padding and the record after it together.
+                read += recordBytes(record->size_);
+                next_read_index_.store(read, std::memory_order_release);
+                record = recordAt(read);
+            }
+            return record;
+        }
+
+        /**
+         * @brief Hand the space taken up by the record returned by peek() back to the producer.
+         */
+        void consume() noexcept {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            if (!hasUnread(read)) [[unlikely]] {
+                utils::FATAL("Attempted to read from empty ring!");
+            }
+            next_read_index_.store(read + recordBytes(recordAt(read)->size_), std::memory_order_release);
+        }
+
+    private:
+        size_t offset(size_t index) const noexcept {
+            return index & (capacity() - 1);
+        }
+
+        ByteRecord* recordAt(size_t index) noexcept {
+            return std::launder(reinterpret_cast<ByteRecord*>(&data_[offset(index)]));
+        }
+
+        /**
+         * @brief Space a record with this payload size takes up in the ring, header and alignment included
+         */
+        static constexpr size_t recordBytes(size_t size) noexcept {
+            return sizeof(ByteRecord) + (size + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+        }
+
+        bool hasRoom(size_t write, size_t bytes) noexcept {
+            if (write + bytes - cached_read_index_ <= capacity()) [[likely]] {
+                return true;
+            }
+            cached_read_index_ = next_read_index_.load(std::memory_order_acquire);
+            return write + bytes - cached_read_index_ <= capacity();
+        }
+
+        bool hasUnread(size_t read) noexcept {
+            if (read != cached_write_index_) [[likely]] {
+                return true;
+            }
+            cached_write_index_ = next_write_index_.load(std::memory_order_acquire);
+            return read != cached_write_index_;
+        }
+    };
+}
@@ -0,0 +1,294 @@
+#pragma once
+/**
+ * @file mpmcqueue.hpp
+ * @brief Multiple producer, multiple consumer, lock free bounded queue
+ * @version 0.1
+ * @test tests/lfds/test_mpmcqueue.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "utils/constants.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief A lock free, bounded queue that any number of threads can write to and read from.
+     * Meant for spreading work that is off the hot path over a pool of worker threads.
+     * Every slot has a turn counter. On lap L around the ring, a slot is free for the producer that claims it while its
+     * turn is 2L, and ready for the consumer that claims it while its turn is 2L + 1. Producers and consumers claim
+     * cursors with a single atomic operation, so nobody ever waits on anything but the turn of their own slot.
+     *
+     * try* methods never block: they give up if the queue is full/empty. The others claim a cursor unconditionally
+     * and then wait (yielding the core) for their slot's turn, which is fair - threads are served in the order
+     * they arrived.
+     *
+     * @note Elements are constructed in the queue when pushed, and destroyed once popped.
+     * @tparam T Type of objects contained by the queue. Must be nothrow move constructible.
+     * @tparam N Capacity, fixed at compile time (must be a power of two), or utils::DYNAMIC_CAPACITY to
+     * allocate storage at construction.
+     */
+    template<typename T, size_t N = utils::DYNAMIC_CAPACITY>
+    class MPMCQueue final {
+    private:
+        static constexpr bool IS_STATIC { N != utils::DYNAMIC_CAPACITY };
+        static_assert(!IS_STATIC || std::has_single_bit(N), "MPMCQueue capacity must be a power of two");
+        static_assert(std::is_nothrow_move_constructible_v<T>, "MPMCQueue elements must be nothrow move constructible");
+
+        // Each slot gets its own cache line so threads working on neighbouring slots don't contend.
+        struct alignas(utils::CACHE_LINE_SIZE) Slot {
+            std::atomic<size_t> turn_ { 0 };
+            alignas(T) std::byte storage_[sizeof(T)];
+
+            T* element() noexcept {
+                return std::launder(reinterpret_cast<T*>(storage_));
+            }
+        };
+
+        std::conditional_t<IS_STATIC, std::array<Slot, N>, std::vector<Slot>> slots_{};
+
+        // Next index to write to. Shared by all producers.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_write_index_ {0};
+
+        // Next index to read from. Shared by all consumers.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_read_index_ {0};
+
+    public:
+        /**
+         * @brief Create new MPMC queue. Storage is allocated, but no elements are constructed.
+         * @param size Number of elements to dynamically allocate
+         */
+        explicit MPMCQueue(std::size_t size) requires (!IS_STATIC)
+            : slots_(size)
+        {}
+
+        /**
+         * @brief Create new MPMC queue with compile time capacity.
+         * @note Storage is inline, so think twice before putting a large queue on the stack.
+         */
+        MPMCQueue() requires IS_STATIC = default;
+
+        /**
+         * @brief Destroys any elements that were pushed but never popped.
+         * @note No threads may be using the queue at this point.
+         */
+        ~MPMCQueue() {
+            for (auto& slot : slots_) {
+                if (slot.turn_.load(std::memory_order_relaxed) & 1) {
+                    slot.element()->~T();
+                }
+            }
+        }
+
+        // Delete copy, move ctors and assignment operators
+        MPMCQueue(const MPMCQueue&) = delete;
+        MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+        MPMCQueue(MPMCQueue&&) = delete;
+        MPMCQueue& operator=(MPMCQueue&&) = delete;
+
+        /**
+         * @brief Approximate number of elements in the queue.
+         * @note Counts elements that are still being written/read, and is a snapshot that may be stale by the time it is returned.
+         */
+        size_t size() const noexcept {
+            const auto read { next_read_index_.load(std::memory_order_acquire) };
+            const auto write { next_write_index_.load(std::memory_order_acquire) };
+            // Blocked consumers can claim cursors ahead of producers
+            return write > read ? write - read : 0;
+        }
+
+        /**
+         * @brief Number of elements the queue can hold
+         */
+        constexpr size_t capacity() const noexcept {
+            if constexpr (IS_STATIC) {
+                return N;
+            } else {
+                return slots_.size();
+            }
+        }
+
+        /**
+         * @brief Construct a new element at the back of the queue, waiting for space if the queue is full.
+         * @param args Arguments forwarded to the constructor of T
+         */
+        template<typename... Args>
+        void emplace(Args&&... args) noexcept {
+            const auto write { next_write_index_.fetch_add(1, std::memory_order_acq_rel) };
+            Slot& slot { slots_[index(write)] };
+            while (slot.turn_.load(std::memory_order_acquire) != writeTurn(write)) {
+                std::this_thread::yield();
+            }
+            construct(slot, write, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Construct a new element at the back of the queue if there is space.
+         * @param args Arguments forwarded to the constructor of T
+         * @return true if the element was pushed, false if the queue was full
+         */
+        template<typename... Args>
+        bool tryEmplace(Args&&... args) noexcept {
+            auto write { next_write_index_.load(std::memory_order_acquire) };
+            while (true) {
+                Slot& slot { slots_[index(write)] };
+                if (slot.turn_.load(std::memory_order_acquire) == writeTurn(write)) {
+                    // On failure, write is reloaded for us
+                    if (next_write_index_.compare_exchange_weak(write, write + 1, std::memory_order_acq_rel)) {
+                        construct(slot, write, std::forward<Args>(args)...);
+                        return true;
+                    }
+                } else {
+                    // If nobody else moved the cursor either, the slot is still in use from the last lap - queue is full
+                    const auto prev { write };
+                    write = next_write_index_.load(std::memory_order_acquire);
+                    if (write == prev) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        void push(const T& value) noexcept { emplace(value); }
+        void push(T&& value) noexcept { emplace(std::move(value)); }
+
+        bool tryPush(const T& value) noexcept { return tryEmplace(value); }
+        bool tryPush(T&& value) noexcept { return tryEmplace(std::move(value)); }
+
+        /**
+         * @brief Pop the element at the front of the queue, waiting for one to arrive if the queue is empty.
+         * @param out Element is moved into here
+         */
+        void pop(T& out) noexcept {
+            const auto read { next_read_index_.fetch_add(1, std::memory_order_acq_rel) };
+            Slot& slot { slots_[index(read)] };
+            while (slot.turn_.load(std::memory_order_acquire) != readTurn(read)) {
+                std::this_thread::yield();
+            }
+            moveOut(slot, read, out);
+        }
+
+        /**
+         * @brief Pop the element at the front of the queue, if there is one.
+         * @param out Element is moved into here
+         * @return true if an element was popped, false if the queue was empty
+         */
+        bool tryPop(T& out) noexcept {
+            auto read { next_read_index_.load(std::memory_order_acquire) };
+            while (true) {
+                Slot& slot { slots_[index(read)] };
+                if (slot.turn_.load(std::memory_order_acquire) == readTurn(read)) {
+                    if (next_read_index_.compare_exchange_weak(read, read + 1, std::memory_order_acq_rel)) {
+                        moveOut(slot, read, out);
+                        return true;
+                    }
+                } else {
+                    const auto prev { read };
+                    read = next_read_index_.load(std::memory_order_acquire);
+                    if (read == prev) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief Pop up to max_count elements in one go, claiming them with a single CAS.
+         * Takes the run of ready elements at the front of the queue, so it can return fewer than max_count even
+         * if more are on the way.
+         * @param out Elements are moved into out[0], out[1], ...
+         * @param max_count Maximum number of elements to pop
+         * @return size_t number of elements popped, 0 if the queue was empty
+         */
+        size_t tryPopBatch(T* out, size_t max_count) noexcept {
+            auto read { next_read_index_.load(std::memory_order_acquire) };
+            while (true) {
+                // Count how many consecutive slots from read are ready. Another consumer can only take them from us by
+                // moving the read cursor, in which case the CAS below fails and we start over.
+                size_t count { 0 };
+                while (count < max_count && count < capacity() &&
+                    slots_[index(read + count)].turn_.load(std::memory_order_acquire) == readTurn(read + count)) {
+                    ++count;
+                }
+
+                if (count == 0) {
+                    const auto prev { read };
+                    read = next_read_index_.load(std::memory_order_acquire);
+                    if (read == prev) {
+                        return 0;
+                    }
+                    continue;
+                }
+
+                if (next_read_index_.compare_exchange_weak(read, read + count, std::memory_order_acq_rel)) {
+                    for (size_t i { 0 }; i < count; ++i) {
+                        moveOut(slots_[index(read + i)], read + i, out[i]);
+                    }
+                    return count;
+                }
+            }
+        }
+
+        /**
+         * @brief Same as tryPopBatch(), but waits (yielding the core) until at least one element is available.
+         * @return size_t number of elements popped, always at least 1
+         */
+        size_t popBatch(T* out, size_t max_count) noexcept {
+            size_t count;
+            while (!(count = tryPopBatch(out, max_count))) {
+                std::this_thread::yield();
+            }
+            return count;
+        }
+
+    private:
+        /**
+         * @brief Map a cursor to the slot it refers to
+         */
+        size_t index(size_t cursor) const noexcept {
+            if constexpr (IS_STATIC) {
+                return cursor & (N - 1);
+            } else {
+                return cursor % slots_.size();
+            }
+        }
+
+        /**
+         * @brief Turn at which the slot for this cursor is free for its producer
+         */
+        size_t writeTurn(size_t cursor) const noexcept {
+            return (cursor / capacity()) * 2;
+        }
+
+        /**
+         * @brief Turn at which the slot for this cursor holds an element for its consumer
+         */
+        size_t readTurn(size_t cursor) const noexcept {
+            return writeTurn(cursor) + 1;
+        }
+
+        template<typename... Args>
+        void construct(Slot& slot, size_t cursor, Args&&... args) noexcept {
+            ::new (slot.storage_) T(std::forward<Args>(args)...);
+            slot.turn_.store(readTurn(cursor), std::memory_order_release);
+        }
+
+        void moveOut(Slot& slot, size_t cursor, T& out) noexcept {
+            out = std::move(*slot.element());
+            slot.element()->~T();
+            // Free for the producer on the next lap
+            slot.turn_.store(writeTurn(cursor) + 2, std::memory_order_release);
+        }
+    };
+}
@@ -0,0 +1,192 @@
+#pragma once
+/**
+ * @file mpscqueue.hpp
+ * @brief Multiple producer, single consumer, lock free bounded queue
+ * @version 0.1
+ * @test tests/lfds/test_mpscqueue.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <vector>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+#include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief A lock free, bounded queue that any number of threads can write to, and one thread reads from.
+     * Every slot carries a sequence number saying whose turn it is - the producer that claimed the slot
+     * (a single CAS on the write cursor), the consumer once the producer has published it, or the next
+     * lap of producers once the consumer is done with it. So producers never wait on each other, except for retrying
+     * the CAS when another producer claimed the same slot first, and never wait on the consumer unless the queue is full.
+     * @note Elements are published in the order they were claimed. A producer that claims a slot and then stalls
+     * before calling updateWriteIndex() holds up the consumer until it's done, so keep the gap between the two short.
+     * @tparam T Type of objects contained by the queue
+     * @tparam N Capacity, fixed at compile time (must be a power of two), or utils::DYNAMIC_CAPACITY to
+     * allocate storage at construction.
+     */
+    template<typename T, size_t N = utils::DYNAMIC_CAPACITY>
+    class MPSCQueue final {
+    private:
+        static constexpr bool IS_STATIC { N != utils::DYNAMIC_CAPACITY };
+        static_assert(!IS_STATIC || std::has_single_bit(N), "MPSCQueue capacity must be a power of two");
+
+        // Each slot gets its own cache line so producers writing neighbouring slots don't contend.
+        struct alignas(utils::CACHE_LINE_SIZE) Slot {
+            // Equal to cursor: free for the producer that claims cursor.
+            // Equal to cursor + 1: written, ready for the consumer.
+            std::atomic<size_t> sequence_ { 0 };
+            T data_ {};
+        };
+
+        std::conditional_t<IS_STATIC, std::array<Slot, N>, std::vector<Slot>> slots_{};
+
+        // Next index to claim. Shared by all producers.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_write_index_ {0};
+
+        // Next unread index. Written by consumer only, atomic so size() can be called from other threads.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_read_index_ {0};
+
+    public:
+        /**
+         * @brief Create new MPSC queue, with given size and all elements default constructed
+         * @param size Number of elements to dynamically allocate
+         */
+        explicit MPSCQueue(std::size_t size) requires (!IS_STATIC)
+            : slots_(size)
+        {
+            initSequences();
+        }
+
+        /**
+         * @brief Create new MPSC queue with compile time capacity, all elements default constructed.
+         * @note Storage is inline, so think twice before putting a large queue on the stack.
+         */
+        MPSCQueue() requires IS_STATIC {
+            initSequences();
+        }
+
+        // Delete copy, move ctors and assignment operators
+        MPSCQueue(const MPSCQueue&) = delete;
+        MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+        MPSCQueue(MPSCQueue&&) = delete;
+        MPSCQueue& operator=(MPSCQueue&&) = delete;
+
+        /**
+         * @brief Get the number of elements that have been claimed by producers but not yet read.
+         * @note Snapshot only, may be stale by the time it is returned.
+         * @return size_t
+         */
+        size_t size() const noexcept {
+            const auto read { next_read_index_.load(std::memory_order_acquire) };
+            const auto write { next_write_index_.load(std::memory_order_acquire) };
+            return write - read;
+        }
+
+        /**
+         * @brief Number of elements the queue can hold
+         */
+        constexpr size_t capacity() const noexcept {
+            if constexpr (IS_STATIC) {
+                return N;
+            } else {
+                return slots_.size();
+            }
+        }
+
+        /**
+         * @brief Claim the next free slot and get a pointer to its element. Object is already either default constructed or has prior value from an earlier write.
+         * @note Remember to call updateWriteIndex() with the returned pointer after writing!
+         * @return T* pointer to element, or nullptr if the queue is full.
+         */
+        T* getNextWriteTo() noexcept {
+            auto write { next_write_index_.load(std::memory_order_relaxed) };
+            while (true) {
+                Slot& slot { slots_[index(write)] };
+                const auto sequence { slot.sequence_.load(std::memory_order_acquire) };
+                const auto diff { static_cast<std::intptr_t>(sequence - write) };
+
+                if (diff == 0) {
+                    // Slot is free for this cursor, try to claim it. On failure, write is reloaded for us.
+                    if (next_write_index_.compare_exchange_weak(write, write + 1, std::memory_order_relaxed)) {
+                        return &slot.data_;
+                    }
+                } else if (diff < 0) {
+                    // Consumer hasn't finished with this slot from the last lap - queue is full
+                    return nullptr;
+                } else {
+                    // Another producer claimed this cursor before us
+                    write = next_write_index_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        /**
+         * @brief Publish an element claimed by getNextWriteTo() to the consumer.
+         * @param element Pointer returned by getNextWriteTo()
+         */
+        void updateWriteIndex(T* element) noexcept {
+            Slot& slot { slotOf(element) };
+            slot.sequence_.store(slot.sequence_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Get a pointer to the next object to be read.
+         * @note Consumer side only. Remember to call updateReadIndex() after reading!
+         * @return T* or nullptr if there is nothing to read (or the next producer in line hasn't finished writing)
+         */
+        T* getNextRead() noexcept {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            Slot& slot { slots_[index(read)] };
+            return (slot.sequence_.load(std::memory_order_acquire) == read + 1) ? &slot.data_ : nullptr;
+        }
+
+        /**
+         * @brief Hand the slot that was just read back to producers, and move on to the next element.
+         */
+        void updateReadIndex() noexcept {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            Slot& slot { slots_[index(read)] };
+            if (slot.sequence_.load(std::memory_order_relaxed) != read + 1) [[unlikely]] {
+                utils::FATAL("Attempted to read from empty queue!");
+            }
+            // Free for the producer that claims this slot on the next lap around
+            slot.sequence_.store(read + capacity(), std::memory_order_release);
+            next_read_index_.store(read + 1, std::memory_order_relaxed);
+        }
+
+    private:
+        void initSequences() noexcept {
+            for (size_t i { 0 }; i < capacity(); ++i) {
+                slots_[i].sequence_.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Map a cursor to the slot it refers to
+         */
+        size_t index(size_t cursor) const noexcept {
+            if constexpr (IS_STATIC) {
+                return cursor & (N - 1);
+            } else {
+                return cursor % slots_.size();
+            }
+        }
+
+        /**
+         * @brief Find the slot an element handed out by getNextWriteTo() lives in
+         */
+        Slot& slotOf(T* element) noexcept {
+            const auto offset { reinterpret_cast<const char*>(element) - reinterpret_cast<const char*>(&slots_[0].data_) };
+            return slots_[offset / sizeof(Slot)];
+        }
+    };
+}
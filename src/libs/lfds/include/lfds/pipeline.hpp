@@ -0,0 +1,349 @@
+#pragma once
+/**
+ * @file pipeline.hpp
+ * @brief Chain of stages, each on its own pinned thread, connected by SPSC queues
+ * @version 0.1
+ * @test tests/lfds/test_pipeline.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+#include "utils/threads/threads.hpp"
+#include "lfds/spscqueue.hpp"
+#include "lfds/queue_telemetry.hpp"
+#include "lfds/wait_strategy.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief Snapshot of one pipeline stage's counters.
+     */
+    struct StageStats {
+        std::string name;
+        int core_id { -1 };
+        // Elements taken from the input queue (for the source, elements produced)
+        size_t processed { 0 };
+        // Elements passed on to the next stage
+        size_t emitted { 0 };
+        // Number of batches handled, and time spent handling them
+        size_t batches { 0 };
+        uint64_t busy_ns { 0 };
+        uint64_t max_batch_ns { 0 };
+        // Telemetry of the queue feeding this stage (empty for the source)
+        QueueStats input;
+    };
+
+    /**
+     * @brief Builds and runs a chain of stages, e.g. decode -> book update -> signal -> order, where each stage runs on
+     * its own thread (pinned with utils::threads::createAndStart()) and hands its output to the next one through an SPSCQueue.
+     *
+     * Stages are declared in order, and the types flow through:
+     *
+     *     Pipeline pipeline;
+     *     pipeline.source<Packet>("decode", 1, [](Packet& out) { return readPacket(out); })
+     *         .then<BookUpdate>("book", 2, [](const Packet& in, BookUpdate& out) { return decode(in, out); })
+     *         .then<Signal>("signal", 3, [](const BookUpdate& in, Signal& out) { return evaluate(in, out); })
+     *         .sink("order", 4, [](const Signal& in) { sendOrder(in); });
+     *     pipeline.start();
+     *
+     * - A source fills in out and returns true if it produced something, false if there was nothing this time.
+     * - A middle stage fills in out and returns true to pass it on, false to filter the input out.
+     * - A sink just consumes its input.
+     * Stages write their output straight into the next queue's slots, so element types must be default constructible.
+     *
+     * Stages hand elements over in batches of up to MAX_BATCH: a stage takes everything waiting in its input (up to
+     * MAX_BATCH), and publishes everything it produced from it with one cursor update. If the next stage falls behind,
+     * its queue fills up and the stage waits - backpressure goes all the way to the source.
+     *
+     * @tparam Wait How an idle stage waits for work. The wait condition polls the stage, so it must be one of the spinning
+     * strategies from wait_strategy.hpp - nothing ever calls notify().
+     * @tparam MAX_BATCH Largest batch a stage handles at once
+     */
+    template<typename Wait = SpinThenYieldWait<>, size_t MAX_BATCH = 64>
+    class Pipeline final {
+    public:
+        template<typename T>
+        using Link = SPSCQueue<T, utils::DYNAMIC_CAPACITY, QueueOverflow::FAIL_FAST, QueueTelemetry<64>>;
+
+    private:
+        struct Stage {
+            const std::string name_;
+            const int core_id_;
+            const Stage* upstream_;
+
+            // Handle whatever is waiting, returning true if there was anything
+            std::function<bool()> poll_;
+            // Nothing left to do, now or ever
+            std::function<bool()> done_;
+            std::function<QueueStats()> input_stats_;
+            // Thread body. Lives here so it outlives createAndStart(), which runs it by reference.
+            std::function<void()> run_;
+
+            // Written by the stage's thread only
+            alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> processed_ { 0 };
+            std::atomic<size_t> emitted_ { 0 };
+            std::atomic<size_t> batches_ { 0 };
+            std::atomic<uint64_t> busy_ns_ { 0 };
+            std::atomic<uint64_t> max_batch_ns_ { 0 };
+            std::atomic<bool> finished_ { false };
+
+            Stage(const std::string& name, int core_id, const Stage* upstream)
+                : name_ { name }, core_id_ { core_id }, upstream_ { upstream }
+            {}
+
+            void record(size_t processed, size_t emitted, uint64_t start_ns) noexcept {
+                const auto elapsed { nanos() - start_ns };
+                processed_.store(processed_.load(std::memory_order_relaxed) + processed, std::memory_order_relaxed);
+                emitted_.store(emitted_.load(std::memory_order_relaxed) + emitted, std::memory_order_relaxed);
+                batches_.store(batches_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                busy_ns_.store(busy_ns_.load(std::memory_order_relaxed) + elapsed, std::memory_order_relaxed);
+                if (elapsed > max_batch_ns_.load(std::memory_order_relaxed)) {
+                    max_batch_ns_.store(elapsed, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        const size_t link_capacity_;
+
+        std::vector<std::unique_ptr<Stage>> stages_;
+        // Queues between stages, type erased
+        std::vector<std::shared_ptr<void>> links_;
+        std::vector<std::thread> threads_;
+
+        bool has_sink_ { false };
+        std::atomic<bool> stopping_ { false };
+
+    public:
+        /**
+         * @brief Stage of the pipeline under construction, whose output is of type Out.
+         */
+        template<typename Out>
+        class Chain final {
+        private:
+            Pipeline& pipeline_;
+            Link<Out>& output_;
+            const Stage& stage_;
+
+        public:
+            Chain(Pipeline& pipeline, Link<Out>& output, const Stage& stage)
+                : pipeline_ { pipeline }, output_ { output }, stage_ { stage }
+            {}
+
+            /**
+             * @brief Add a stage that turns each Out of the previous stage into a Next (or filters it out).
+             * @param name Name of the stage's thread
+             * @param core_id Core to pin the stage to, or -1 to leave it unpinned
+             * @param fn bool(const Out& in, Next& out) - returns true if out was filled in and should be passed on
+             */
+            template<typename Next, typename Fn>
+            Chain<Next> then(const std::string& name, int core_id, Fn&& fn) {
+                auto& next { pipeline_.template addLink<Next>() };
+                auto& stage { pipeline_.addStage(name, core_id, &stage_, output_) };
+                stage.poll_ = [&stage, &input = output_, &next, fn = std::forward<Fn>(fn)]() mutable {
+                    auto in { input.peekBatch(MAX_BATCH) };
+                    if (in.empty()) {
+                        return false;
+                    }
+                    const auto start { nanos() };
+                    size_t consumed { 0 }, emitted { 0 };
+                    while (consumed < in.size()) {
+                        // Next stage is full - come back for the rest later
+                        auto out { next.reserveBatch(in.size() - consumed) };
+                        if (out.empty()) {
+                            break;
+                        }
+                        size_t produced { 0 };
+                        while (consumed < in.size() && produced < out.size()) {
+                            if (fn(std::as_const(in[consumed++]), out[produced])) {
+                                ++produced;
+                            }
+                        }
+                        next.commitBatch(produced);
+                        emitted += produced;
+                    }
+                    input.releaseBatch(consumed);
+                    stage.record(consumed, emitted, start);
+                    return consumed > 0;
+                };
+                return Chain<Next> { pipeline_, next, stage };
+            }
+
+            /**
+             * @brief Finish the pipeline with a stage that consumes each Out of the previous stage.
+             * @param fn void(const Out& in)
+             */
+            template<typename Fn>
+            void sink(const std::string& name, int core_id, Fn&& fn) {
+                auto& stage { pipeline_.addStage(name, core_id, &stage_, output_) };
+                stage.poll_ = [&stage, &input = output_, fn = std::forward<Fn>(fn)]() mutable {
+                    auto in { input.peekBatch(MAX_BATCH) };
+                    if (in.empty()) {
+                        return false;
+                    }
+                    const auto start { nanos() };
+                    for (const auto& element : in) {
+                        fn(element);
+                    }
+                    input.releaseBatch(in.size());
+                    stage.record(in.size(), 0, start);
+                    return true;
+                };
+                pipeline_.has_sink_ = true;
+            }
+        };
+
+        /**
+         * @param link_capacity Capacity of each queue between stages
+         */
+        explicit Pipeline(size_t link_capacity = 4096)
+            : link_capacity_ { link_capacity }
+        {}
+
+        /**
+         * @brief Stops the pipeline if it's still running.
+         */
+        ~Pipeline() {
+            stop();
+        }
+
+        // Delete copy, move ctors and assignment operators - stages refer back to the pipeline
+        Pipeline(const Pipeline&) = delete;
+        Pipeline& operator=(const Pipeline&) = delete;
+
+        Pipeline(Pipeline&&) = delete;
+        Pipeline& operator=(Pipeline&&) = delete;
+
+        /**
+         * @brief Start declaring the pipeline with the stage that feeds it.
+         * @param name Name of the stage's thread
+         * @param core_id Core to pin the stage to, or -1 to leave it unpinned
+         * @param fn bool(Out& out) - returns true if out was filled in, false if there was nothing to produce this time
+         */
+        template<typename Out, typename Fn>
+        Chain<Out> source(const std::string& name, int core_id, Fn&& fn) {
+            utils::ASSERT(stages_.empty(), "Pipeline can only have one source.");
+            auto& output { addLink<Out>() };
+            auto& stage { *stages_.emplace_back(std::make_unique<Stage>(name, core_id, nullptr)) };
+            stage.poll_ = [&stage, &output, fn = std::forward<Fn>(fn)]() mutable {
+                auto out { output.reserveBatch(MAX_BATCH) };
+                if (out.empty()) {
+                    return false;
+                }
+                const auto start { nanos() };
+                size_t produced { 0 };
+                while (produced < out.size() && fn(out[produced])) {
+                    ++produced;
+                }
+                if (!produced) {
+                    return false;
+                }
+                output.commitBatch(produced);
+                stage.record(produced, produced, start);
+                return true;
+            };
+            stage.done_ = [this]() { return stopping_.load(std::memory_order_acquire); };
+            stage.input_stats_ = []() { return QueueStats {}; };
+            return Chain<Out> { *this, output, stage };
+        }
+
+        /**
+         * @brief Start a thread for every stage, last stage first, so each stage's consumer is running before it is.
+         */
+        void start() {
+            utils::ASSERT(has_sink_, "Pipeline must end in a sink before it can be started.");
+            utils::ASSERT(threads_.empty(), "Pipeline already started.");
+            for (auto it { stages_.rbegin() }; it != stages_.rend(); ++it) {
+                auto& stage { **it };
+                stage.run_ = [&stage]() {
+                    Wait wait;
+                    while (true) {
+                        wait.wait([&stage]() { return stage.poll_() || stage.done_(); });
+                        if (stage.done_()) {
+                            break;
+                        }
+                    }
+                    stage.finished_.store(true, std::memory_order_release);
+                };
+                auto thread { utils::threads::createAndStart(stage.core_id_, stage.name_, stage.run_) };
+                // Comes back already joined if the thread couldn't be pinned, and the stages around it would wait forever
+                utils::ASSERT(thread.joinable(), "Failed to start pipeline stage " + stage.name_ + ".");
+                threads_.push_back(std::move(thread));
+            }
+        }
+
+        /**
+         * @brief Stop the source, let every other stage finish what is already in its queue, and join all threads.
+         */
+        void stop() {
+            stopping_.store(true, std::memory_order_release);
+            for (auto& thread : threads_) {
+                if (thread.joinable()) {
+                    thread.join();
+                }
+            }
+            threads_.clear();
+        }
+
+        /**
+         * @brief Counters for every stage, in pipeline order.
+         * @note Safe to call from any thread while the pipeline is running.
+         */
+        std::vector<StageStats> stats() const {
+            std::vector<StageStats> all;
+            for (const auto& stage : stages_) {
+                StageStats stats;
+                stats.name = stage->name_;
+                stats.core_id = stage->core_id_;
+                stats.processed = stage->processed_.load(std::memory_order_relaxed);
+                stats.emitted = stage->emitted_.load(std::memory_order_relaxed);
+                stats.batches = stage->batches_.load(std::memory_order_relaxed);
+                stats.busy_ns = stage->busy_ns_.load(std::memory_order_relaxed);
+                stats.max_batch_ns = stage->max_batch_ns_.load(std::memory_order_relaxed);
+                stats.input = stage->input_stats_();
+                all.push_back(stats);
+            }
+            return all;
+        }
+
+    private:
+        template<typename T>
+        Link<T>& addLink() {
+            auto link { std::make_shared<Link<T>>(link_capacity_) };
+            links_.push_back(link);
+            return *link;
+        }
+
+        /**
+         * @brief Add a stage fed by input. The stage is done once the stage before it is, and it has emptied its input.
+         */
+        template<typename In>
+        Stage& addStage(const std::string& name, int core_id, const Stage* upstream, Link<In>& input) {
+            utils::ASSERT(!has_sink_, "Pipeline already ends in a sink.");
+            auto& stage { *stages_.emplace_back(std::make_unique<Stage>(name, core_id, upstream)) };
+            stage.done_ = [upstream, &input]() {
+                return upstream->finished_.load(std::memory_order_acquire) && input.size() == 0;
+            };
+            stage.input_stats_ = [&input]() { return input.stats(); };
+            return stage;
+        }
+
+        static uint64_t nanos() noexcept {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()
+            ).count();
+        }
+    };
+}
@@ -0,0 +1,199 @@
+#pragma once
+/**
+ * @file queue_telemetry.hpp
+ * @brief Optional, compile time instrumentation for queues: depth, full/empty events, and time spent in the queue
+ * @version 0.1
+ * @test tests/lfds/test_queue_telemetry.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "utils/constants.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief Snapshot of a queue's telemetry, for a monitor thread.
+     */
+    struct QueueStats {
+        // Number of elements in the queue when the snapshot was taken
+        size_t depth { 0 };
+        // Highest depth seen (sampled, see QueueTelemetry)
+        size_t peak_depth { 0 };
+        // Times the producer found the queue full
+        size_t full_events { 0 };
+        // Times the consumer drained the queue, i.e. peekBatch() found nothing left to read
+        size_t empty_events { 0 };
+        // Time between an element being published and being consumed, for the sampled elements
+        size_t residency_samples { 0 };
+        uint64_t residency_total_ns { 0 };
+        uint64_t residency_max_ns { 0 };
+
+        double meanResidencyNanos() const noexcept {
+            return residency_samples ? static_cast<double>(residency_total_ns) / residency_samples : 0.0;
+        }
+    };
+
+    /*
+     * A queue takes its telemetry as a template parameter, and calls these hooks on it:
+     *
+     *  - onPublish(first, count, loadReadIndex)   Producer published elements [first, first + count).
+     *  - onFull(capacity)                         Producer found the queue full.
+     *  - onConsume(first, count)                  Consumer finished with elements [first, first + count).
+     *  - onEmpty()                                Consumer drained the queue (peekBatch() came back empty). Not
+     *                                             counted by getNextRead()/tryPop(), which are often polled.
+     *
+     * NoTelemetry compiles all of them away, and takes up no space with [[no_unique_address]].
+     */
+
+    /**
+     * @brief Default telemetry: does nothing.
+     */
+    class NoTelemetry final {
+    public:
+        static constexpr bool ENABLED { false };
+
+        explicit NoTelemetry(size_t) noexcept {}
+
+        template<typename LoadReadIndex>
+        void onPublish(size_t, size_t, LoadReadIndex&&) noexcept {}
+        void onFull(size_t) noexcept {}
+        void onConsume(size_t, size_t) noexcept {}
+        void onEmpty() noexcept {}
+    };
+
+    /**
+     * @brief Counts full/empty events, tracks peak depth, and measures how long elements sit in the queue.
+     *
+     * Each side's counters are on a cache line that only that side writes, so the hot threads never contend with each
+     * other or with a monitor reading them (which only costs the monitor a cache miss). Counters are updated with plain
+     * relaxed load/store, since each has a single writer.
+     *
+     * Anything that needs a clock or the other side's cursor is only done for one element in SAMPLE_EVERY: the producer
+     * timestamps it and measures depth, and the consumer measures the time since that timestamp when it's consumed.
+     *
+     * @tparam SAMPLE_EVERY Sample one element in this many. Must be a power of two.
+     */
+    template<size_t SAMPLE_EVERY = 1024>
+    class QueueTelemetry final {
+    private:
+        static_assert(std::has_single_bit(SAMPLE_EVERY), "QueueTelemetry sample interval must be a power of two");
+
+        // Producer side
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> peak_depth_ { 0 };
+        std::atomic<size_t> full_events_ { 0 };
+
+        // Consumer side
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> empty_events_ { 0 };
+        std::atomic<size_t> residency_samples_ { 0 };
+        std::atomic<uint64_t> residency_total_ns_ { 0 };
+        std::atomic<uint64_t> residency_max_ns_ { 0 };
+
+        // Publish time of sampled elements, indexed by sample number. Written by the producer before it publishes the
+        // element and read by the consumer after, so the queue's own cursors order the accesses. Big enough that a
+        // sample can't be reused while its element is still in a bounded queue. An unbounded queue can hold more than
+        // capacity, and then the producer may reuse a sample slot early - relaxed atomics keep that well defined, and
+        // the residency for that sample is just understated.
+        alignas(utils::CACHE_LINE_SIZE) const size_t sample_slots_;
+        const std::unique_ptr<std::atomic<uint64_t>[]> publish_nanos_;
+
+    public:
+        static constexpr bool ENABLED { true };
+
+        /**
+         * @param capacity Capacity of the queue being instrumented (for an unbounded queue, the depth it normally stays under)
+         */
+        explicit QueueTelemetry(size_t capacity)
+            : sample_slots_ { capacity / SAMPLE_EVERY + 2 }, publish_nanos_ { std::make_unique<std::atomic<uint64_t>[]>(sample_slots_) }
+        {}
+
+        // Delete copy, move ctors and assignment operators
+        QueueTelemetry(const QueueTelemetry&) = delete;
+        QueueTelemetry& operator=(const QueueTelemetry&) = delete;
+
+        QueueTelemetry(QueueTelemetry&&) = delete;
+        QueueTelemetry& operator=(QueueTelemetry&&) = delete;
+
+        template<typename LoadReadIndex>
+        void onPublish(size_t first, size_t count, LoadReadIndex&& loadReadIndex) noexcept {
+            auto sampled { firstSampled(first) };
+            if (sampled >= first + count) [[likely]] {
+                return;
+            }
+            const auto now { nanos() };
+            for (; sampled < first + count; sampled += SAMPLE_EVERY) {
+                publish_nanos_[(sampled / SAMPLE_EVERY) % sample_slots_].store(now, std::memory_order_relaxed);
+            }
+            bump(peak_depth_, first + count - loadReadIndex());
+        }
+
+        void onFull(size_t capacity) noexcept {
+            increment(full_events_);
+            bump(peak_depth_, capacity);
+        }
+
+        void onConsume(size_t first, size_t count) noexcept {
+            auto sampled { firstSampled(first) };
+            if (sampled >= first + count) [[likely]] {
+                return;
+            }
+            const auto now { nanos() };
+            for (; sampled < first + count; sampled += SAMPLE_EVERY) {
+                const auto residency { now - std::min(now, publish_nanos_[(sampled / SAMPLE_EVERY) % sample_slots_].load(std::memory_order_relaxed)) };
+                increment(residency_samples_);
+                residency_total_ns_.store(residency_total_ns_.load(std::memory_order_relaxed) + residency, std::memory_order_relaxed);
+                bump(residency_max_ns_, residency);
+            }
+        }
+
+        void onEmpty() noexcept {
+            increment(empty_events_);
+        }
+
+        /**
+         * @brief Copy of the counters. Safe to call from any thread. Depth is left for the queue to fill in.
+         */
+        QueueStats snapshot() const noexcept {
+            QueueStats stats;
+            stats.peak_depth = peak_depth_.load(std::memory_order_relaxed);
+            stats.full_events = full_events_.load(std::memory_order_relaxed);
+            stats.empty_events = empty_events_.load(std::memory_order_relaxed);
+            stats.residency_samples = residency_samples_.load(std::memory_order_relaxed);
+            stats.residency_total_ns = residency_total_ns_.load(std::memory_order_relaxed);
+            stats.residency_max_ns = residency_max_ns_.load(std::memory_order_relaxed);
+            return stats;
+        }
+
+    private:
+        static size_t firstSampled(size_t index) noexcept {
+            return (index + SAMPLE_EVERY - 1) & ~(SAMPLE_EVERY - 1);
+        }
+
+        // Steady clock, so a wall clock adjustment can't make a residency negative
+        static uint64_t nanos() noexcept {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()
+            ).count();
+        }
+
+        template<typename U>
+        static void increment(std::atomic<U>& counter) noexcept {
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        template<typename U>
+        static void bump(std::atomic<U>& max, U value) noexcept {
+            if (value > max.load(std::memory_order_relaxed)) {
+                max.store(value, std::memory_order_relaxed);
+            }
+        }
+    };
+}
@@ -0,0 +1,274 @@
+#pragma once
+/**
+ * @file rcu_map.hpp
+ * @brief Read-copy-update map for read mostly data, with quiescent state based reclamation
+ * @version 0.1
+ * @test tests/lfds/test_rcu_map.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief Map that hot threads read on every message and an admin thread updates occasionally, e.g. instrument
+     * definitions, tick sizes, limits.
+     *
+     * Each version of the map is immutable. A writer copies the current version, changes the copy, and publishes it
+     * with one atomic pointer swap. Readers just load the pointer - no locks, no atomic read-modify-writes, and never
+     * a retry - so a lookup costs the same as in a plain map.
+     *
+     * Old versions are freed with quiescent state based reclamation (QSBR): each reader registers, and calls
+     * quiescent() at points where it holds no references into the map, e.g. between messages. Once every reader has
+     * passed a quiescent point since a version was replaced, nobody can still be reading it, and the writer frees it.
+     * A reader that will stop calling quiescent() for a while (e.g. going idle) calls offline() so it doesn't hold
+     * reclamation up.
+     *
+     * @tparam Key Key type
+     * @tparam Value Value type
+     * @tparam MAX_READERS Most readers that can be registered at once
+     * @tparam Map Map type each version is held in. Copied on every update.
+     */
+    template<typename Key, typename Value, size_t MAX_READERS = 64, typename Map = std::unordered_map<Key, Value>>
+    class RcuMap final {
+    private:
+        // Epoch a reader announces when it isn't reading at all
+        static constexpr uint64_t OFFLINE { 0 };
+
+        struct alignas(utils::CACHE_LINE_SIZE) ReaderSlot {
+            std::atomic<bool> in_use_ { false };
+            // Last global epoch the reader announced at a quiescent point, or OFFLINE. Written by the reader only.
+            std::atomic<uint64_t> epoch_ { OFFLINE };
+        };
+
+        struct Retired {
+            const Map* map_;
+            // Epoch the version was replaced in. Safe to free once every online reader has announced this epoch or later.
+            uint64_t epoch_;
+        };
+
+        // Current version. Read by readers on every lookup, so it gets a cache line to itself.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<const Map*> current_;
+
+        // Bumped after every publish
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<uint64_t> epoch_ { 1 };
+
+        std::array<ReaderSlot, MAX_READERS> readers_;
+
+        // Writer side state. Writers are rare, so they just take a lock among themselves.
+        std::mutex write_mutex_;
+        std::vector<Retired> retired_;
+
+    public:
+        /**
+         * @brief Registration of one reader thread with the map. Must only be used from that thread.
+         * Unregisters when destroyed.
+         */
+        class Reader final {
+        private:
+            RcuMap* map_;
+            ReaderSlot* slot_;
+
+        public:
+            Reader(RcuMap& map, ReaderSlot& slot) noexcept
+                : map_ { &map }, slot_ { &slot }
+            {
+                quiescent();
+            }
+
+            ~Reader() {
+                if (slot_) {
+                    offline();
+                    slot_->in_use_.store(false, std::memory_order_release);
+                }
+            }
+
+            Reader(const Reader&) = delete;
+            Reader& operator=(const Reader&) = delete;
+
+            Reader(Reader&& other) noexcept
+                : map_ { other.map_ }, slot_ { std::exchange(other.slot_, nullptr) }
+            {}
+
+            Reader& operator=(Reader&&) = delete;
+
+            /**
+             * @brief Current version of the map. Stays valid until this reader's next quiescent() or offline().
+             */
+            const Map& get() const noexcept {
+                return *map_->current_.load(std::memory_order_acquire);
+            }
+
+            /**
+             * @brief Look a key up in the current version.
+             * @return const Value* or nullptr if the key isn't in the map. Valid until the next quiescent() or offline().
+             */
+            const Value* find(const Key& key) const noexcept {
+                const auto& map { get() };
+                const auto it { map.find(key) };
+                return it == map.end() ? nullptr : &it->second;
+            }
+
+            /**
+             * @brief Announce that this reader holds no references into the map, letting the writer free versions
+             * replaced before now. Call it regularly, e.g. once per message. Also brings an offline reader back online.
+             * @note One store and one fence - no read-modify-write.
+             */
+            void quiescent() noexcept {
+                slot_->epoch_.store(map_->epoch_.load(std::memory_order_acquire), std::memory_order_release);
+                // Our announcement must be visible before we next load current_, see RcuMap::publish()
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+
+            /**
+             * @brief Stop holding up reclamation, e.g. before going idle. No references into the map may be kept,
+             * and the reader must call quiescent() before reading again.
+             */
+            void offline() noexcept {
+                slot_->epoch_.store(OFFLINE, std::memory_order_release);
+            }
+        };
+
+        /**
+         * @brief Create new map, starting from initial
+         */
+        explicit RcuMap(Map initial = Map())
+            : current_ { new Map(std::move(initial)) }
+        {}
+
+        /**
+         * @brief Frees every version.
+         * @note No reader may be using the map at this point.
+         */
+        ~RcuMap() {
+            delete current_.load(std::memory_order_relaxed);
+            for (const auto& retired : retired_) {
+                delete retired.map_;
+            }
+        }
+
+        // Delete copy, move ctors and assignment operators
+        RcuMap(const RcuMap&) = delete;
+        RcuMap& operator=(const RcuMap&) = delete;
+
+        RcuMap(RcuMap&&) = delete;
+        RcuMap& operator=(RcuMap&&) = delete;
+
+        /**
+         * @brief Register the calling thread as a reader. The reader starts online.
+         */
+        Reader registerReader() noexcept {
+            ReaderSlot* free { nullptr };
+            for (auto& slot : readers_) {
+                bool expected { false };
+                if (!slot.in_use_.load(std::memory_order_relaxed) &&
+                    slot.in_use_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+                    free = &slot;
+                    break;
+                }
+            }
+            utils::ASSERT(free, "Too many RcuMap readers registered!");
+            return Reader { *this, *free };
+        }
+
+        /**
+         * @brief Publish a new version: a copy of the current one, changed by fn. Then free any old versions
+         * no reader can still be using.
+         * @param fn void(Map&) - applies the changes
+         */
+        template<typename Fn>
+        void update(Fn&& fn) {
+            std::lock_guard lock { write_mutex_ };
+            auto next { new Map(*current_.load(std::memory_order_relaxed)) };
+            fn(*next);
+            publish(next);
+        }
+
+        /**
+         * @brief Set key to value in a new version.
+         */
+        void insertOrAssign(const Key& key, const Value& value) {
+            update([&](Map& map) { map.insert_or_assign(key, value); });
+        }
+
+        /**
+         * @brief Remove key in a new version.
+         */
+        void erase(const Key& key) {
+            update([&](Map& map) { map.erase(key); });
+        }
+
+        /**
+         * @brief Free old versions that no reader can still be using.
+         */
+        void reclaim() {
+            std::lock_guard lock { write_mutex_ };
+            reclaimRetired();
+        }
+
+        /**
+         * @brief Wait (yielding) until every old version has been freed, i.e. until every online reader has passed a
+         * quiescent point. For shutdown, or an admin thread that wants memory back now - never on a hot thread.
+         */
+        void synchronize() {
+            std::unique_lock lock { write_mutex_ };
+            while (!reclaimRetired()) {
+                lock.unlock();
+                std::this_thread::yield();
+                lock.lock();
+            }
+        }
+
+        /**
+         * @brief Number of replaced versions not yet freed.
+         */
+        size_t retired() {
+            std::lock_guard lock { write_mutex_ };
+            return retired_.size();
+        }
+
+    private:
+        void publish(const Map* next) {
+            const auto previous { current_.exchange(next, std::memory_order_acq_rel) };
+            // A reader that announces this epoch (or later) loaded it after the swap, so it can only see next
+            retired_.push_back({ previous, epoch_.fetch_add(1, std::memory_order_acq_rel) + 1 });
+            // Pairs with the fence in Reader::quiescent(): either we see a reader's announcement, or it sees next
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            reclaimRetired();
+        }
+
+        /**
+         * @return true if nothing is left to free
+         */
+        bool reclaimRetired() {
+            auto oldest { UINT64_MAX };
+            for (const auto& slot : readers_) {
+                const auto epoch { slot.epoch_.load(std::memory_order_acquire) };
+                if (epoch != OFFLINE) {
+                    oldest = std::min(oldest, epoch);
+                }
+            }
+
+            const auto safe { std::partition(retired_.begin(), retired_.end(),
+                [oldest](const Retired& retired) { return retired.epoch_ > oldest; }) };
+            for (auto it { safe }; it != retired_.end(); ++it) {
+                delete it->map_;
+            }
+            retired_.erase(safe, retired_.end());
+            return retired_.empty();
+        }
+    };
+}
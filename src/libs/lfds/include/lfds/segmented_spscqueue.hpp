@@ -0,0 +1,390 @@
+#pragma once
+/**
+ * @file segmented_spscqueue.hpp
+ * @brief Single producer, single consumer, lock free queue that grows in fixed size segments
+ * @version 0.1
+ * @test tests/lfds/test_segmented_spscqueue.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+#include "utils/memory.hpp"
+#include "lfds/spscqueue.hpp"
+#include "lfds/queue_telemetry.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief Unbounded single producer/consumer queue, made of a linked list of fixed size segments.
+     * When the producer fills a segment it links on another one, so the queue never drops or waits, and only needs to be
+     * sized for the common case rather than the worst burst. When the consumer has read everything in a segment it
+     * hands it back to the producer through a second SPSCQueue running the other way, so once the queue has grown
+     * to what the load needs, it reuses those segments and never allocates.
+     *
+     * Within a segment this works exactly like SPSCQueue: monotonic cursors on their own cache lines, elements
+     * constructed in place when written and destroyed when read, and the same single and batch APIs. Batches stop at
+     * the end of a segment rather than the end of the ring.
+     *
+     * @tparam T Type of objects contained by the queue
+     * @tparam SEGMENT_SIZE Elements per segment. Must be a power of two.
+     * @tparam Telemetry Instrumentation, see queue_telemetry.hpp. It's sized for the initial segments - residency
+     * samples may be understated while the queue holds more than that.
+     * @tparam Memory Where segments come from, see utils/memory.hpp. With utils::HugePageMemory, size segments to a
+     * whole number of huge pages.
+     */
+    template<typename T, size_t SEGMENT_SIZE = 4096, typename Telemetry = NoTelemetry, typename Memory = utils::HeapMemory>
+    class SegmentedSPSCQueue final {
+    private:
+        static_assert(std::has_single_bit(SEGMENT_SIZE), "SegmentedSPSCQueue segment size must be a power of two");
+
+        struct Slot {
+            alignas(T) std::byte storage_[sizeof(T)];
+        };
+
+        struct Segment {
+            Slot* const slots_;
+            // Set by the producer before it publishes anything in the next segment
+            std::atomic<Segment*> next_ { nullptr };
+        };
+
+        static constexpr size_t SEGMENT_BYTES { SEGMENT_SIZE * sizeof(Slot) };
+
+        // Drained segments on their way back from the consumer to the producer
+        SPSCQueue<Segment*> recycled_;
+
+        [[no_unique_address]] Telemetry telemetry_;
+
+        // Next index to write to. Written by producer only.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_write_index_ {0};
+
+        // Segment next_write_index_ is in
+        Segment* write_segment_ {nullptr};
+
+        // Number of slots from next_write_index_ on that getNextWriteTo()/reserveBatch() already constructed
+        size_t constructed_ahead_ {0};
+
+        // Segments allocated over the lifetime of the queue. Written by producer only.
+        std::atomic<size_t> allocated_segments_ {0};
+
+        // Next unread index. Written by consumer only.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_read_index_ {0};
+
+        // Consumer's last seen value of next_write_index_. Only refreshed when the queue looks empty.
+        size_t cached_write_index_ {0};
+
+        // Segment next_read_index_ is in
+        Segment* read_segment_ {nullptr};
+
+        // Segments freed because the recycle queue was full. Written by consumer only.
+        std::atomic<size_t> freed_segments_ {0};
+
+    public:
+        /**
+         * @brief Create new segmented queue. Segments are allocated from Memory up front, but no elements are constructed.
+         * @param initial_segments Segments to allocate now. The queue only allocates when it needs more than this at once.
+         * @param max_spare_segments Most drained segments to keep for reuse - any more are freed, so the memory from a
+         * rare burst isn't held forever.
+         */
+        explicit SegmentedSPSCQueue(size_t initial_segments = 1, size_t max_spare_segments = 16)
+            : recycled_ { std::max(initial_segments, max_spare_segments) }, telemetry_ { initial_segments * SEGMENT_SIZE }
+        {
+            utils::ASSERT(initial_segments > 0, "SegmentedSPSCQueue needs at least one segment.");
+            write_segment_ = read_segment_ = allocateSegment();
+            for (size_t i { 1 }; i < initial_segments; ++i) {
+                recycled_.push(allocateSegment());
+            }
+        }
+
+        /**
+         * @brief Destroys any elements that were written but never consumed, and frees every segment.
+         * @note Neither side may be using the queue at this point.
+         */
+        ~SegmentedSPSCQueue() {
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                auto segment { read_segment_ };
+                const auto end { next_write_index_.load(std::memory_order_relaxed) + constructed_ahead_ };
+                for (auto i { next_read_index_.load(std::memory_order_relaxed) }; i != end; ++i) {
+                    if (i != next_read_index_.load(std::memory_order_relaxed) && !offset(i)) {
+                        segment = segment->next_.load(std::memory_order_relaxed);
+                    }
+                    element(segment, i)->~T();
+                }
+            }
+            for (auto segment { read_segment_ }; segment;) {
+                auto next { segment->next_.load(std::memory_order_relaxed) };
+                freeSegment(segment);
+                segment = next;
+            }
+            Segment* spare;
+            while (recycled_.tryPop(spare)) {
+                freeSegment(spare);
+            }
+        }
+
+        // Delete copy, move ctors and assignment operators
+        SegmentedSPSCQueue(const SegmentedSPSCQueue&) = delete;
+        SegmentedSPSCQueue& operator=(const SegmentedSPSCQueue&) = delete;
+
+        SegmentedSPSCQueue(SegmentedSPSCQueue&&) = delete;
+        SegmentedSPSCQueue& operator=(SegmentedSPSCQueue&&) = delete;
+
+        /**
+         * @brief Get the number of elements in the queue.
+         * @note Safe to call from any thread, but it reads both cursors, so keep it off the hot path.
+         */
+        size_t size() const noexcept {
+            const auto read { next_read_index_.load(std::memory_order_acquire) };
+            const auto write { next_write_index_.load(std::memory_order_acquire) };
+            return write - read;
+        }
+
+        /**
+         * @brief Number of segments currently allocated, in use or spare.
+         * @note Safe to call from any thread.
+         */
+        size_t segments() const noexcept {
+            return allocated_segments_.load(std::memory_order_relaxed) - freed_segments_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Snapshot of the queue's telemetry. The queue is never full, so there are no full events.
+         * @note Safe to call from any thread.
+         */
+        QueueStats stats() const noexcept requires Telemetry::ENABLED {
+            auto stats { telemetry_.snapshot() };
+            stats.depth = size();
+            return stats;
+        }
+
+        /**
+         * @brief Get a pointer to the next element to write to, default initialised in place.
+         * @note Remember to call updateWriteIndex() after writing!
+         * @return T* - pointer to element, never nullptr
+         */
+        T* getNextWriteTo() noexcept requires std::default_initializable<T> {
+            const auto write { next_write_index_.load(std::memory_order_relaxed) };
+            if (!constructed_ahead_) {
+                ::new (write_segment_->slots_[offset(write)].storage_) T;
+                constructed_ahead_ = 1;
+            }
+            return element(write_segment_, write);
+        }
+
+        /**
+         * @brief Publish the element written to getNextWriteTo() to the consumer, and move on to the next slot.
+         */
+        void updateWriteIndex() noexcept {
+            commitBatch(1);
+        }
+
+        /**
+         * @brief Construct a new element at the back of the queue. Always succeeds, linking on a new segment if needed.
+         * @param args Arguments forwarded to the constructor of T
+         */
+        template<typename... Args>
+        void emplace(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args&&...>) {
+            const auto write { next_write_index_.load(std::memory_order_relaxed) };
+            // Replace a slot getNextWriteTo()/reserveBatch() handed out but that was never committed
+            if (constructed_ahead_) {
+                element(write_segment_, write)->~T();
+                --constructed_ahead_;
+            }
+            ::new (write_segment_->slots_[offset(write)].storage_) T(std::forward<Args>(args)...);
+            publish(write, 1);
+        }
+
+        void push(const T& value) { emplace(value); }
+        void push(T&& value) noexcept(std::is_nothrow_move_constructible_v<T>) { emplace(std::move(value)); }
+
+        /**
+         * @brief Reserve up to count slots to write to, which are published together by commitBatch().
+         * The span stops at the end of the current segment, so it can be shorter than count - call again after
+         * committing to get the rest. Only empty if count is 0.
+         * @note Producer side only. Slots are default initialised in place, same as getNextWriteTo().
+         * @param count Number of slots wanted
+         * @return std::span<T> slots that can be written to
+         */
+        std::span<T> reserveBatch(size_t count) noexcept requires std::default_initializable<T> {
+            const auto write { next_write_index_.load(std::memory_order_relaxed) };
+            const auto reserved { std::min(count, SEGMENT_SIZE - offset(write)) };
+            for (; constructed_ahead_ < reserved; ++constructed_ahead_) {
+                ::new (write_segment_->slots_[offset(write + constructed_ahead_)].storage_) T;
+            }
+            return { element(write_segment_, write), reserved };
+        }
+
+        /**
+         * @brief Publish the first count slots returned by reserveBatch() to the consumer, with a single cursor update.
+         * @param count Number of slots written, no more than the size of the reserved span
+         */
+        void commitBatch(size_t count) noexcept {
+            if (count > constructed_ahead_) [[unlikely]] {
+                utils::FATAL("Attempted to commit more elements than were reserved!");
+            }
+            constructed_ahead_ -= count;
+            publish(next_write_index_.load(std::memory_order_relaxed), count);
+        }
+
+        /**
+         * @brief Get a pointer to the next object to be read.
+         * @note Remember to call updateReadIndex() after reading!
+         * @return T* or nullptr if there is nothing to read
+         */
+        T* getNextRead() noexcept {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            if (!hasUnread(read)) {
+                return nullptr;
+            }
+            return element(read_segment_, read);
+        }
+
+        /**
+         * @brief Destroy the element that was just read, and move on to the next element.
+         */
+        void updateReadIndex() noexcept {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            if (!hasUnread(read)) [[unlikely]] {
+                utils::FATAL("Attempted to read from empty queue!");
+            }
+            element(read_segment_, read)->~T();
+            release(read, 1);
+        }
+
+        /**
+         * @brief Pop the element at the front of the queue, if there is one.
+         * @param out Element is moved into here
+         * @return true if an element was popped, false if the queue was empty
+         */
+        bool tryPop(T& out) noexcept(std::is_nothrow_move_assignable_v<T>) {
+            auto next { getNextRead() };
+            if (!next) {
+                return false;
+            }
+            out = std::move(*next);
+            updateReadIndex();
+            return true;
+        }
+
+        /**
+         * @brief Pop the element at the front of the queue, waiting (yielding the core) for one to arrive if the queue is empty.
+         * @param out Element is moved into here
+         */
+        void pop(T& out) noexcept(std::is_nothrow_move_assignable_v<T>) {
+            while (!tryPop(out)) {
+                std::this_thread::yield();
+            }
+        }
+
+        /**
+         * @brief Get up to max_count unread elements in one go. They stay in the queue until releaseBatch() is called.
+         * The span stops at the end of the current segment. Empty if there is nothing to read.
+         * @note Consumer side only.
+         * @param max_count Maximum number of elements wanted
+         * @return std::span<T> elements that can be read
+         */
+        std::span<T> peekBatch(size_t max_count = SIZE_MAX) noexcept {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            if (cached_write_index_ - read < max_count) {
+                cached_write_index_ = next_write_index_.load(std::memory_order_acquire);
+            }
+            if (cached_write_index_ == read && max_count) {
+                telemetry_.onEmpty();
+            }
+            return { element(read_segment_, read), std::min({ max_count, cached_write_index_ - read, SEGMENT_SIZE - offset(read) }) };
+        }
+
+        /**
+         * @brief Destroy the first count elements returned by peekBatch(), with a single cursor update.
+         * @param count Number of elements consumed, no more than the size of the peeked span
+         */
+        void releaseBatch(size_t count) noexcept {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            if (count > std::min(cached_write_index_ - read, SEGMENT_SIZE - offset(read))) [[unlikely]] {
+                utils::FATAL("Attempted to release more elements than were read!");
+            }
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                for (size_t i { 0 }; i < count; ++i) {
+                    element(read_segment_, read + i)->~T();
+                }
+            }
+            release(read, count);
+        }
+
+    private:
+        static size_t offset(size_t index) noexcept {
+            return index & (SEGMENT_SIZE - 1);
+        }
+
+        static T* element(Segment* segment, size_t index) noexcept {
+            return std::launder(reinterpret_cast<T*>(segment->slots_[offset(index)].storage_));
+        }
+
+        /**
+         * @brief Move the write cursor on past count written elements. If that fills the segment, link on the next one
+         * first, so the consumer always finds it there when it reaches the end of this one.
+         */
+        void publish(size_t write, size_t count) noexcept {
+            telemetry_.onPublish(write, count, [this]() { return next_read_index_.load(std::memory_order_acquire); });
+            if (!offset(write + count) && count) [[unlikely]] {
+                Segment* next;
+                if (!recycled_.tryPop(next)) {
+                    next = allocateSegment();
+                }
+                next->next_.store(nullptr, std::memory_order_relaxed);
+                write_segment_->next_.store(next, std::memory_order_relaxed);
+                write_segment_ = next;
+            }
+            next_write_index_.store(write + count, std::memory_order_release);
+        }
+
+        /**
+         * @brief Move the read cursor on past count consumed elements. If that drains the segment, move on to the
+         * next one and send the drained one back to the producer.
+         */
+        void release(size_t read, size_t count) noexcept {
+            telemetry_.onConsume(read, count);
+            if (!offset(read + count) && count) [[unlikely]] {
+                auto drained { read_segment_ };
+                // Linked before the write cursor that got us here was published
+                read_segment_ = drained->next_.load(std::memory_order_relaxed);
+                if (!recycled_.tryPush(drained)) {
+                    freeSegment(drained);
+                    freed_segments_.store(freed_segments_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                }
+            }
+            next_read_index_.store(read + count, std::memory_order_release);
+        }
+
+        bool hasUnread(size_t read) noexcept {
+            if (read != cached_write_index_) [[likely]] {
+                return true;
+            }
+            cached_write_index_ = next_write_index_.load(std::memory_order_acquire);
+            return read != cached_write_index_;
+        }
+
+        Segment* allocateSegment() {
+            allocated_segments_.store(allocated_segments_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return new Segment { static_cast<Slot*>(Memory::allocate(SEGMENT_BYTES)) };
+        }
+
+        static void freeSegment(Segment* segment) noexcept {
+            Memory::deallocate(segment->slots_, SEGMENT_BYTES);
+            delete segment;
+        }
+    };
+}
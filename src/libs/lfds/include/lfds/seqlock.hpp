@@ -0,0 +1,140 @@
+#pragma once
+/**
+ * @file seqlock.hpp
+ * @brief Single writer, multiple reader snapshot of a value, using sequence locks
+ * @version 0.1
+ * @test tests/lfds/test_seqlock.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+#include <immintrin.h>
+#include "utils/constants.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief Publishes a value from one writer thread to any number of reader threads.
+     * The writer bumps a sequence number to odd, writes the value and bumps it back to even. A reader copies the value
+     * out, and keeps it if the sequence number was the same even number before and after the copy. Readers never write
+     * to shared memory, so adding readers costs the writer nothing.
+     *
+     * With N > 1, the writer cycles through N slots, each with its own sequence number, and readers go to the slot
+     * that was published last. A reader then only has to retry if the writer gets through N more writes during its copy,
+     * rather than whenever a write overlaps it.
+     *
+     * @note Only ever one writer thread.
+     * @tparam T Type of the value. Must be trivially copyable, since readers may copy it while it is being written
+     * (the copy is then thrown away).
+     * @tparam N Number of slots the writer cycles through.
+     */
+    template<typename T, size_t N = 1>
+    class SeqLock final {
+    private:
+        static_assert(std::is_trivially_copyable_v<T>, "SeqLock value must be trivially copyable");
+        static_assert(N >= 1, "SeqLock needs at least one slot");
+
+        struct alignas(utils::CACHE_LINE_SIZE) Slot {
+            // Twice the version of the value held, plus one while that value is being written
+            std::atomic<size_t> sequence_ { 0 };
+            T data_ {};
+        };
+
+        // Version of the most recently published value. Only needed to find the right slot with N > 1.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> version_ { 0 };
+
+        std::array<Slot, N> slots_ {};
+
+    public:
+        /**
+         * @brief Create a new SeqLock. Readers see a value initialized T until the first store().
+         */
+        SeqLock() = default;
+
+        // Delete copy, move ctors and assignment operators
+        SeqLock(const SeqLock&) = delete;
+        SeqLock& operator=(const SeqLock&) = delete;
+
+        SeqLock(SeqLock&&) = delete;
+        SeqLock& operator=(SeqLock&&) = delete;
+
+        /**
+         * @brief Publish a new value to readers.
+         * @note Writer thread only.
+         * @param value Value to publish
+         */
+        void store(const T& value) noexcept {
+            const auto version { version_.load(std::memory_order_relaxed) + 1 };
+            Slot& slot { slots_[version % N] };
+
+            slot.sequence_.store(version * 2 - 1, std::memory_order_relaxed);
+            // Sequence must be seen as odd before any part of the new value is seen
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(&slot.data_, &value, sizeof(T));
+            slot.sequence_.store(version * 2, std::memory_order_release);
+
+            version_.store(version, std::memory_order_release);
+        }
+
+        /**
+         * @brief Get a consistent copy of the latest value, retrying if the copy overlapped a write.
+         * @param version If not null, set to the version of the value returned (number of stores before it was published).
+         * @return T copy of the value
+         */
+        T load(size_t* version = nullptr) const noexcept {
+            T copy;
+            while (!tryLoad(copy, version)) {
+                _mm_pause();
+            }
+            return copy;
+        }
+
+        /**
+         * @brief Attempt to copy the latest value once, without retrying.
+         * @param out Value is copied into here. Contents are unspecified if the attempt fails.
+         * @param version If not null, set to the version of the value copied.
+         * @return true if out holds a consistent value, false if the copy overlapped a write.
+         */
+        bool tryLoad(T& out, size_t* version = nullptr) const noexcept {
+            const Slot& slot { slots_[latestSlot()] };
+
+            const auto before { slot.sequence_.load(std::memory_order_acquire) };
+            if (before & 1) [[unlikely]] {
+                return false;
+            }
+            std::memcpy(&out, &slot.data_, sizeof(T));
+            // Copy must be complete before sequence is checked again
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const auto after { slot.sequence_.load(std::memory_order_relaxed) };
+
+            if (before != after) [[unlikely]] {
+                return false;
+            }
+            if (version) {
+                *version = before / 2;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Version of the latest value published (number of calls to store() so far).
+         */
+        size_t version() const noexcept {
+            return version_.load(std::memory_order_acquire);
+        }
+
+    private:
+        size_t latestSlot() const noexcept {
+            if constexpr (N == 1) {
+                return 0;
+            } else {
+                return version_.load(std::memory_order_acquire) % N;
+            }
+        }
+    };
+}
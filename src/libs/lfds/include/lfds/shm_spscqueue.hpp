@@ -0,0 +1,354 @@
+#pragma once
+/**
+ * @file shm_spscqueue.hpp
+ * @brief Single producer, single consumer, lock free queue in shared memory, for passing messages between processes
+ * @version 0.1
+ * @test tests/lfds/test_shm_spscqueue.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief Which process sets up the shared memory segment
+     */
+    enum class ShmRole {
+        // Creates the segment, or reuses one with a matching layout left behind by an earlier run
+        CREATOR,
+        // Waits for the creator to finish setting the segment up, then maps it
+        ATTACHER,
+    };
+
+    /**
+     * @brief SPSCQueue equivalent where the ring and both cursors live in a named POSIX shared memory segment, so the
+     * producer and consumer can be in different processes. Nothing on the data path makes a system call.
+     *
+     * The segment starts with a header describing its layout (magic, layout version, element size and capacity), which
+     * an attacher checks before using it, and a ready flag that the creator sets only once everything else is initialised.
+     * A creator that finds a segment with a valid header and a matching layout reuses it as is, cursors and all, so either
+     * side can crash and restart without losing messages that were already published: data is always written before the
+     * cursor that publishes it. A ready segment with a different layout is never touched, as other processes may still
+     * be using it - the creator asserts instead. If the ready flag was never set (creator died while setting up), the
+     * creator unlinks the segment and creates a new one, and an attacher still waiting on the old one moves over to it.
+     *
+     * @note The segment outlives both processes - call remove() to get rid of it.
+     * @tparam T Type of message. Must be trivially copyable, as it is shared between address spaces.
+     */
+    template<typename T>
+    class ShmSPSCQueue final {
+    private:
+        static_assert(std::is_trivially_copyable_v<T>, "ShmSPSCQueue elements must be trivially copyable");
+        static_assert(std::atomic<size_t>::is_always_lock_free, "Shared memory cursors need lock free atomics");
+
+        static constexpr uint64_t MAGIC { 0x4846545348505343 }; // "HFTSHPSC"
+        static constexpr uint32_t LAYOUT_VERSION { 1 };
+
+        static constexpr uint32_t STATE_INITIALISING { 0 };
+        static constexpr uint32_t STATE_READY { 1 };
+
+        struct alignas(utils::CACHE_LINE_SIZE) Header {
+            uint64_t magic_;
+            uint32_t layout_version_;
+            uint32_t element_size_;
+            uint64_t capacity_;
+            std::atomic<uint32_t> state_;
+        };
+
+        // Laid out at the start of the segment, followed by the ring itself
+        struct Control {
+            Header header_;
+
+            // Next index to write to. Written by producer only.
+            alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_write_index_;
+
+            // Next unread index. Written by consumer only.
+            alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_read_index_;
+        };
+
+        static constexpr size_t DATA_OFFSET { (sizeof(Control) + alignof(T) - 1) / alignof(T) * alignof(T) };
+
+        const std::string name_;
+        const size_t capacity_;
+        const size_t mapping_size_;
+
+        int fd_ { -1 };
+        Control* control_ { nullptr };
+        T* data_ { nullptr };
+
+        // Producer's last seen value of next_read_index_. Local to this process.
+        alignas(utils::CACHE_LINE_SIZE) size_t cached_read_index_ { 0 };
+
+        // Consumer's last seen value of next_write_index_. Local to this process.
+        alignas(utils::CACHE_LINE_SIZE) size_t cached_write_index_ { 0 };
+
+    public:
+        /**
+         * @brief Create or attach to a shared memory queue. Asserts if the segment can't be set up, or if an existing
+         * segment has a different layout.
+         * @param name Name of the segment, in shm_open() format ("/name")
+         * @param role Whether this process sets the segment up, or attaches to one set up by another process
+         * @param capacity Number of messages in the ring. Must be a power of two, and the same for both processes.
+         * @param attach_timeout How long an attacher waits for the creator to get the segment ready
+         */
+        ShmSPSCQueue(const std::string& name, ShmRole role, size_t capacity,
+            std::chrono::milliseconds attach_timeout = std::chrono::seconds { 5 })
+            : name_ { name }, capacity_ { capacity }, mapping_size_ { DATA_OFFSET + capacity * sizeof(T) }
+        {
+            utils::ASSERT(std::has_single_bit(capacity_), "ShmSPSCQueue capacity must be a power of two: " + name_);
+            if (role == ShmRole::CREATOR) {
+                create();
+            } else {
+                attach(attach_timeout);
+            }
+            data_ = reinterpret_cast<T*>(reinterpret_cast<char*>(control_) + DATA_OFFSET);
+            cached_read_index_ = control_->next_read_index_.load(std::memory_order_acquire);
+            cached_write_index_ = control_->next_write_index_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief Unmap the segment. The segment itself (and any messages in it) stays around for the next process.
+         */
+        ~ShmSPSCQueue() {
+            munmap(control_, mapping_size_);
+            close(fd_);
+        }
+
+        // Delete default, copy, move ctors and assignment operators
+        ShmSPSCQueue() = delete;
+
+        ShmSPSCQueue(const ShmSPSCQueue&) = delete;
+        ShmSPSCQueue& operator=(const ShmSPSCQueue&) = delete;
+
+        ShmSPSCQueue(ShmSPSCQueue&&) = delete;
+        ShmSPSCQueue& operator=(ShmSPSCQueue&&) = delete;
+
+        /**
+         * @brief Delete a shared memory segment. Processes that still have it mapped keep working with it.
+         * @param name Name of the segment
+         * @return true if the segment existed and was removed
+         */
+        static bool remove(const std::string& name) noexcept {
+            return shm_unlink(name.c_str()) == 0;
+        }
+
+        /**
+         * @brief Get the number of messages in the queue.
+         * @note Snapshot only, keep it off the hot path.
+         */
+        size_t size() const noexcept {
+            const auto read { control_->next_read_index_.load(std::memory_order_acquire) };
+            const auto write { control_->next_write_index_.load(std::memory_order_acquire) };
+            return write - read;
+        }
+
+        /**
+         * @brief Number of messages the queue can hold
+         */
+        size_t capacity() const noexcept {
+            return capacity_;
+        }
+
+        /**
+         * @brief Check if the next write would overwrite a message that hasn't been read yet.
+         * @note Producer side only.
+         */
+        bool full() noexcept {
+            const auto write { control_->next_write_index_.load(std::memory_order_relaxed) };
+            if (write - cached_read_index_ < capacity_) [[likely]] {
+                return false;
+            }
+            cached_read_index_ = control_->next_read_index_.load(std::memory_order_acquire);
+            return write - cached_read_index_ >= capacity_;
+        }
+
+        /**
+         * @brief Get a pointer to the next message to write to.
+         * @note Remember to call updateWriteIndex() after writing!
+         */
+        T* getNextWriteTo() noexcept {
+            return &data_[control_->next_write_index_.load(std::memory_order_relaxed) & (capacity_ - 1)];
+        }
+
+        /**
+         * @brief Publish the message written to getNextWriteTo() to the consumer.
+         */
+        void updateWriteIndex() noexcept {
+            const auto write { control_->next_write_index_.load(std::memory_order_relaxed) };
+            control_->next_write_index_.store(write + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Get a pointer to the next message to be read.
+         * @note Remember to call updateReadIndex() after reading!
+         * @return T* or nullptr if there is nothing to read
+         */
+        T* getNextRead() noexcept {
+            const auto read { control_->next_read_index_.load(std::memory_order_relaxed) };
+            return hasUnread(read) ? &data_[read & (capacity_ - 1)] : nullptr;
+        }
+
+        /**
+         * @brief Hand the slot that was just read back to the producer.
+         */
+        void updateReadIndex() noexcept {
+            const auto read { control_->next_read_index_.load(std::memory_order_relaxed) };
+            if (!hasUnread(read)) [[unlikely]] {
+                utils::FATAL("Attempted to read from empty queue!");
+            }
+            control_->next_read_index_.store(read + 1, std::memory_order_release);
+        }
+
+    private:
+        bool hasUnread(size_t read) noexcept {
+            if (read != cached_write_index_) [[likely]] {
+                return true;
+            }
+            cached_write_index_ = control_->next_write_index_.load(std::memory_order_acquire);
+            return read != cached_write_index_;
+        }
+
+        /**
+         * @brief Check if the header describes a segment this queue can use as is
+         */
+        bool layoutMatches(const Header& header) const noexcept {
+            return header.magic_ == MAGIC && header.layout_version_ == LAYOUT_VERSION &&
+                header.element_size_ == sizeof(T) && header.capacity_ == capacity_;
+        }
+
+        void map() {
+            void* ptr { mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0) };
+            utils::ASSERT(ptr != MAP_FAILED, "mmap() failed for " + name_ + ": " + std::strerror(errno));
+            control_ = static_cast<Control*>(ptr);
+        }
+
+        void create() {
+            // Reuse a segment left behind by an earlier run, if it's complete and laid out the same way
+            fd_ = shm_open(name_.c_str(), O_RDWR, 0600);
+            if (fd_ >= 0) {
+                if (reuseExisting()) {
+                    return;
+                }
+                // Never completed. Another process may still have it mapped, so don't resize it under them: unlink it,
+                // and anyone still using it keeps their own copy.
+                close(fd_);
+                remove(name_);
+            }
+
+            // O_EXCL: if another creator beat us to it, we don't want to touch its segment
+            fd_ = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            utils::ASSERT(fd_ >= 0, "shm_open() failed for " + name_ + ": " + std::strerror(errno));
+            // A new segment is zero filled, so the ready flag starts unset
+            utils::ASSERT(ftruncate(fd_, mapping_size_) == 0, "ftruncate() failed for " + name_ + ": " + std::strerror(errno));
+            map();
+
+            Header& header { control_->header_ };
+            header.magic_ = MAGIC;
+            header.layout_version_ = LAYOUT_VERSION;
+            header.element_size_ = sizeof(T);
+            header.capacity_ = capacity_;
+            control_->next_write_index_.store(0, std::memory_order_relaxed);
+            control_->next_read_index_.store(0, std::memory_order_relaxed);
+
+            // Attachers only look at the rest of the segment once they see this
+            header.state_.store(STATE_READY, std::memory_order_release);
+        }
+
+        /**
+         * @brief Map the existing segment open in fd_ if it's ready and laid out like this queue. Asserts if it's
+         * ready with a different layout, as other processes may be using it.
+         * @return false if the segment was never completed (e.g. its creator died while setting it up)
+         */
+        bool reuseExisting() {
+            struct stat st {};
+            utils::ASSERT(fstat(fd_, &st) == 0, "fstat() failed for " + name_ + ": " + std::strerror(errno));
+            if (static_cast<size_t>(st.st_size) < sizeof(Header)) {
+                return false;
+            }
+
+            void* ptr { mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd_, 0) };
+            utils::ASSERT(ptr != MAP_FAILED, "mmap() failed for " + name_ + ": " + std::strerror(errno));
+            const auto& header { *static_cast<const Header*>(ptr) };
+            const bool ready { header.magic_ == MAGIC && header.state_.load(std::memory_order_acquire) == STATE_READY };
+            const bool matches { layoutMatches(header) && static_cast<size_t>(st.st_size) == mapping_size_ };
+            munmap(ptr, sizeof(Header));
+
+            if (!ready) {
+                return false;
+            }
+            utils::ASSERT(matches, "Shared memory segment " + name_ + " has a different layout, remove() it first");
+            map();
+            return true;
+        }
+
+        void attach(std::chrono::milliseconds timeout) {
+            const auto deadline { std::chrono::steady_clock::now() + timeout };
+            const auto waitOrFail = [&](const std::string& reason) {
+                utils::ASSERT(std::chrono::steady_clock::now() < deadline, "Timed out attaching to " + name_ + ": " + reason);
+                std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+            };
+
+            // Wait for the creator to create the segment, give it its full size and finish initialising it. Look the
+            // name up again every time, as a creator that finds an incomplete segment replaces it with a new one.
+            while (true) {
+                if (!openLatest()) {
+                    waitOrFail("segment doesn't exist or is too small");
+                    continue;
+                }
+                if (!control_) {
+                    struct stat st {};
+                    if (fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < mapping_size_) {
+                        waitOrFail("segment doesn't exist or is too small");
+                        continue;
+                    }
+                    map();
+                }
+                if (control_->header_.state_.load(std::memory_order_acquire) == STATE_READY) {
+                    break;
+                }
+                waitOrFail("segment never became ready");
+            }
+            utils::ASSERT(layoutMatches(control_->header_), "Shared memory segment " + name_ + " has a different layout");
+        }
+
+        /**
+         * @brief Point fd_ at the segment currently under name_. If that's no longer the one we have open (it was
+         * unlinked and replaced), drop our mapping of the old one.
+         * @return false if there is no segment under name_ right now
+         */
+        bool openLatest() {
+            const int fd { shm_open(name_.c_str(), O_RDWR, 0600) };
+            if (fd_ >= 0) {
+                struct stat current {}, latest {};
+                if (fd >= 0 && fstat(fd_, &current) == 0 && fstat(fd, &latest) == 0 &&
+                    current.st_ino == latest.st_ino && current.st_dev == latest.st_dev) {
+                    close(fd);
+                    return true;
+                }
+                if (control_) {
+                    munmap(control_, mapping_size_);
+                    control_ = nullptr;
+                }
+                close(fd_);
+            }
+            fd_ = fd;
+            return fd_ >= 0;
+        }
+    };
+}
@@ -2,51 +2,151 @@
 /**
  * @file spscqueue.hpp
  * @brief Single producer, single consumer, lock free queue
- * @version 0.1
+ * @version 0.6
  * @date 2023-08-14
- * @test tests/lfds/spscqueue_test.cpp
- * 
+ * @test tests/lfds/test_spscqueue.cpp
+ *
  * @copyright Copyright (c) 2023
- * 
+ *
  */
 
-#include <vector>
+#include <array>
 #include <atomic>
+#include <bit>
+#include <span>
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+#include "utils/memory.hpp"
+#include "lfds/wait_strategy.hpp"
+#include "lfds/queue_telemetry.hpp"
 
 namespace lfds {
 
+    /**
+     * @brief What the producer does when it wants to write to an SPSCQueue that is full
+     */
+    enum class QueueOverflow {
+        // Give up straight away: push()/emplace() return false. Writing to a full queue through getNextWriteTo() is
+        // fatal, so check full() first.
+        FAIL_FAST,
+        // Wait for the consumer to make space (spinning, then yielding the core)
+        SPIN_UNTIL_SPACE,
+        // Give up like FAIL_FAST (getNextWriteTo() returns nullptr instead), and count the element as dropped. The producer never waits, and nothing already
+        // in the queue is touched.
+        DROP_NEWEST,
+        // Take the oldest unread element away from the consumer and reuse its slot, counting it as overwritten.
+        // The producer never waits. Consumer can only use tryPop()/pop(), and T must be trivially copyable.
+        OVERWRITE_OLDEST,
+    };
+
     /**
      * @brief A lock free, low overhead, single producer/consumer queue.
      * No locks of any kind are used, so no locking/context switch overhead.
-     * This is achieved using atomic variables.
-     * @note Storage for queue is dynamically allocated at construction
+     * The producer and consumer each own one cursor, kept on its own cache line, and only ever
+     * read the other side's cursor when their cached copy of it says the queue is full/empty.
+     * In the common case, neither side touches a cache line written by the other, apart from the element itself.
+     *
+     * Storage is left uninitialised until it is written to: elements are constructed in place when pushed (or when
+     * getNextWriteTo()/reserveBatch() hand out a slot), and destroyed when consumed. So creating a queue doesn't touch
+     * the whole ring up front, and T doesn't have to be default constructible or copyable - emplace()/tryPush()/tryPop()
+     * work with move only types.
+     * @note If N is left as utils::DYNAMIC_CAPACITY, storage for queue is dynamically allocated at construction.
+     * Otherwise, storage is held inline (the queue can live inside the object that owns it), and wrapping around
+     * is a mask rather than a divide.
      * @tparam T Type of objects contained by the queue
+     * @tparam N Capacity, fixed at compile time. Must be a power of two.
+     * @tparam Overflow What the producer does when the queue is full. try* methods always just fail.
+     * @tparam Telemetry Instrumentation, see queue_telemetry.hpp. NoTelemetry (the default) costs nothing.
+     * @tparam Memory Where dynamically allocated storage comes from, see utils/memory.hpp. E.g. utils::HugePageMemory
+     * for a large queue, so it's pre-faulted and doesn't thrash the TLB.
      */
-    template<typename T>
+    template<typename T, size_t N = utils::DYNAMIC_CAPACITY, QueueOverflow Overflow = QueueOverflow::FAIL_FAST,
+        typename Telemetry = NoTelemetry, typename Memory = utils::HeapMemory>
     class SPSCQueue final {
     private:
-        std::vector<T> data_{};
-        
-        // Next unread index
-        std::atomic<size_t> next_read_index_ {0};
+        static constexpr bool IS_STATIC { N != utils::DYNAMIC_CAPACITY };
+        static constexpr bool IS_OVERWRITE { Overflow == QueueOverflow::OVERWRITE_OLDEST };
+        static_assert(!IS_STATIC || std::has_single_bit(N), "SPSCQueue capacity must be a power of two");
+        static_assert(!IS_OVERWRITE || std::is_trivially_copyable_v<T>, "Overwriting SPSCQueue elements must be trivially copyable");
+
+        struct Slot {
+            alignas(T) std::byte storage_[sizeof(T)];
+        };
+        static_assert(sizeof(Slot) == sizeof(T), "Slots must be laid out exactly like an array of T");
+
+        // Raw storage - constructing the queue leaves it untouched
+        std::conditional_t<IS_STATIC, std::array<Slot, N>, std::unique_ptr<Slot[], utils::MemoryDeleter<Memory>>> data_;
+        const size_t capacity_;
+
+        [[no_unique_address]] Telemetry telemetry_;
+
+        // Cursors count up forever, see slot() for how they map to an element.
+        // (a size_t won't wrap around in the lifetime of the system)
+        // The alignment also pads the queue out to a whole number of cache lines, so nothing that
+        // follows the queue in memory can share the consumer's line.
+
+        // Next index to write to. Written by producer only.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_write_index_ {0};
+
+        // Producer's last seen value of next_read_index_. Only refreshed when the queue looks full.
+        size_t cached_read_index_ {0};
+
+        // Number of slots from next_write_index_ on that getNextWriteTo()/reserveBatch() already constructed
+        size_t constructed_ahead_ {0};
+
+        // Elements dropped (DROP_NEWEST) or overwritten (OVERWRITE_OLDEST). Written by producer only.
+        std::atomic<size_t> overflows_ {0};
+
+        // Next unread index. Written by consumer only - except with OVERWRITE_OLDEST, where the producer moves it
+        // on to take the oldest element, and both sides have to claim elements with a CAS.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<size_t> next_read_index_ {0};
 
-        // Next index to write to
-        std::atomic<size_t> next_write_index_ {0};
+        // Consumer's last seen value of next_write_index_. Only refreshed when the queue looks empty.
+        size_t cached_write_index_ {0};
 
-        std::atomic<size_t> size_ {0};
     public:
         /**
-         * @brief Create new SPSC queue, with given size and all elements default constructed
+         * @brief Create new SPSC queue. Storage is allocated from Memory, but no elements are constructed.
          * @param size Number of elements to dynamically allocate
          */
-        SPSCQueue(std::size_t size)
-            : data_(size, T())
+        SPSCQueue(std::size_t size) requires (!IS_STATIC)
+            : data_ { static_cast<Slot*>(Memory::allocate(size * sizeof(Slot))), { size * sizeof(Slot) } },
+              capacity_ { size }, telemetry_ { size }
         {}
 
-        // Delete default, copy, move ctors and assignment operators
-        SPSCQueue() = delete;
-        
+        /**
+         * @brief Create new SPSC queue with compile time capacity. No elements are constructed.
+         * @note Storage is inline, so think twice before putting a large queue on the stack.
+         */
+        SPSCQueue() requires IS_STATIC
+            : capacity_ { N }, telemetry_ { N }
+        {}
+
+        /**
+         * @brief Destroys any elements that were written but never consumed.
+         * @note Neither side may be using the queue at this point.
+         */
+        ~SPSCQueue() {
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                const auto write { next_write_index_.load(std::memory_order_relaxed) };
+                for (auto i { next_read_index_.load(std::memory_order_relaxed) }; i != write + constructed_ahead_; ++i) {
+                    element(i)->~T();
+                }
+            }
+        }
+
+        // Delete copy, move ctors and assignment operators
+
         SPSCQueue(const SPSCQueue&) = delete;
         SPSCQueue& operator=(const SPSCQueue&) = delete;
 
@@ -54,52 +154,377 @@ namespace lfds {
         SPSCQueue& operator=(SPSCQueue&&) = delete;
 
         /**
-         * @brief Get the number of elements in the queue. 
+         * @brief Get the number of elements in the queue.
          * Not just how many were allocated, how many have actually been written.
-         * @return size_t 
+         * @note Safe to call from any thread, but it reads both cursors, so keep it off the hot path.
+         * The value is a snapshot and may be stale by the time it is returned.
+         * @return size_t
          */
         size_t size() const noexcept {
-            return size_;
+            // Load read first - write only ever moves forward, so it is guaranteed to be >= the read we saw
+            const auto read { next_read_index_.load(std::memory_order_acquire) };
+            const auto write { next_write_index_.load(std::memory_order_acquire) };
+            return write - read;
+        }
+
+        /**
+         * @brief Number of elements the queue can hold
+         */
+        constexpr size_t capacity() const noexcept {
+            if constexpr (IS_STATIC) {
+                return N;
+            } else {
+                return capacity_;
+            }
         }
 
+        /**
+         * @brief Snapshot of the queue's telemetry.
+         * @note Safe to call from any thread. Reading the counters doesn't write to either side's cache lines.
+         */
+        QueueStats stats() const noexcept requires Telemetry::ENABLED {
+            auto stats { telemetry_.snapshot() };
+            stats.depth = size();
+            return stats;
+        }
 
         /**
-         * @brief Get a pointer to the next element to write to. Object is already either default constructed or has prior value from an earlier call.
+         * @brief Number of elements dropped (DROP_NEWEST) or overwritten before they were read (OVERWRITE_OLDEST).
+         * @note Can be read from any thread, e.g. a monitor.
+         */
+        size_t overflows() const noexcept {
+            return overflows_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Check if the next write would overwrite an element that hasn't been read yet.
+         * @note Producer side only.
+         * @return true if the queue is full
+         */
+        bool full() noexcept {
+            const auto write { next_write_index_.load(std::memory_order_relaxed) };
+            if (freeSlots(write)) [[likely]] {
+                return false;
+            }
+            cached_read_index_ = next_read_index_.load(std::memory_order_acquire);
+            return !freeSlots(write);
+        }
+
+        /**
+         * @brief Get a pointer to the next element to write to. The element is default initialised in place the first
+         * time it is handed out, so it can be assigned to.
          * Needs to be implemented this way (two methods) due to atomics.
-         * @note Remember to call updateWriteIndex() after writing! 
-         * @return T* - pointer to element.
+         * @note Remember to call updateWriteIndex() after writing! With FAIL_FAST, check full() first - writing to a
+         * full queue is fatal.
+         * @return T* - pointer to element, or nullptr if the queue is full and DROP_NEWEST dropped the element.
          */
-        T* getNextWriteTo() noexcept {
-            return &data_[next_write_index_];
+        T* getNextWriteTo() noexcept requires std::default_initializable<T> {
+            const auto write { next_write_index_.load(std::memory_order_relaxed) };
+            if (!constructed_ahead_) {
+                if (!makeRoom()) [[unlikely]] {
+                    if constexpr (Overflow == QueueOverflow::FAIL_FAST) {
+                        utils::FATAL("Attempted to write to full queue!");
+                    }
+                    return nullptr;
+                }
+                ::new (data_[slot(write)].storage_) T;
+                constructed_ahead_ = 1;
+            }
+            return element(write);
         }
-        
+
         /**
-         * @brief Increment write index, wrapping around if required. Also increments size of queue.
+         * @brief Publish the element written to getNextWriteTo() to the consumer, and move on to the next slot.
          */
         void updateWriteIndex() noexcept {
-            next_write_index_ = (next_write_index_ + 1) % data_.size();
-            ++size_;
+            commitBatch(1);
         }
 
         /**
-         * @brief Get a pointer to the next object to be read. 
+         * @brief Construct a new element at the back of the queue, applying the overflow policy if the queue is full.
+         * @param args Arguments forwarded to the constructor of T
+         * @return true if the element was pushed, false if the overflow policy gave up on it
+         */
+        template<typename... Args>
+        bool emplace(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args&&...>) {
+            if (!makeRoom()) [[unlikely]] {
+                return false;
+            }
+            construct(std::forward<Args>(args)...);
+            return true;
+        }
+
+        /**
+         * @brief Construct a new element at the back of the queue if there is space.
+         * @param args Arguments forwarded to the constructor of T
+         * @return true if the element was pushed, false if the queue was full
+         */
+        template<typename... Args>
+        bool tryEmplace(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args&&...>) {
+            if (full()) {
+                return false;
+            }
+            construct(std::forward<Args>(args)...);
+            return true;
+        }
+
+        bool push(const T& value) { return emplace(value); }
+        bool push(T&& value) noexcept(std::is_nothrow_move_constructible_v<T>) { return emplace(std::move(value)); }
+
+        bool tryPush(const T& value) { return tryEmplace(value); }
+        bool tryPush(T&& value) noexcept(std::is_nothrow_move_constructible_v<T>) { return tryEmplace(std::move(value)); }
+
+        /**
+         * @brief Get a pointer to the next object to be read.
          * Needs to be implemented this way (two methods) due to atomics.
          * @note Remember to call updateReadIndex() after reading!
-         * @return T* 
+         * @return T* or nullptr if there is nothing to read
+         */
+        T* getNextRead() noexcept requires (!IS_OVERWRITE) {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            if (!hasUnread(read)) {
+                return nullptr;
+            }
+            return element(read);
+        }
+
+        /**
+         * @brief Destroy the element that was just read, hand its slot back to the producer, and move on to the next element.
+         */
+        void updateReadIndex() noexcept requires (!IS_OVERWRITE) {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            if (!hasUnread(read)) [[unlikely]] {
+                utils::FATAL("Attempted to read from empty queue!");
+            }
+            element(read)->~T();
+            telemetry_.onConsume(read, 1);
+            next_read_index_.store(read + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Pop the element at the front of the queue, if there is one.
+         * @param out Element is moved into here
+         * @return true if an element was popped, false if the queue was empty
+         */
+        bool tryPop(T& out) noexcept(std::is_nothrow_move_assignable_v<T>) {
+            if constexpr (IS_OVERWRITE) {
+                return claimOldest(out);
+            } else {
+                auto next { getNextRead() };
+                if (!next) {
+                    return false;
+                }
+                out = std::move(*next);
+                updateReadIndex();
+                return true;
+            }
+        }
+
+        /**
+         * @brief Pop the element at the front of the queue, waiting (yielding the core) for one to arrive if the queue is empty.
+         * @param out Element is moved into here
+         */
+        void pop(T& out) noexcept(std::is_nothrow_move_assignable_v<T>) {
+            while (!tryPop(out)) {
+                std::this_thread::yield();
+            }
+        }
+
+        /**
+         * @brief Reserve up to count slots to write to, which are published together by commitBatch().
+         * The span returned is contiguous, so it stops at the end of the ring - it can be shorter than count if
+         * writing count elements would wrap around, or if there isn't enough free space. Call again after committing
+         * to get the rest. Empty if the queue is full.
+         * With SPIN_UNTIL_SPACE, waits until at least one slot is free. With DROP_NEWEST, an empty span counts all count
+         * elements as dropped - the caller is expected to give up on them.
+         * @note Producer side only. Slots are default initialised in place, same as getNextWriteTo().
+         * @param count Number of slots wanted
+         * @return std::span<T> slots that can be written to
+         */
+        std::span<T> reserveBatch(size_t count) noexcept requires (std::default_initializable<T> && !IS_OVERWRITE) {
+            const auto write { next_write_index_.load(std::memory_order_relaxed) };
+            auto free { freeSlots(write) };
+            if (free < count) {
+                cached_read_index_ = next_read_index_.load(std::memory_order_acquire);
+                free = freeSlots(write);
+            }
+            if (!free && count) [[unlikely]] {
+                telemetry_.onFull(capacity());
+                if constexpr (Overflow == QueueOverflow::SPIN_UNTIL_SPACE) {
+                    makeRoom();
+                    free = freeSlots(write);
+                } else if constexpr (Overflow == QueueOverflow::DROP_NEWEST) {
+                    overflows_.store(overflows_.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+                }
+            }
+            const auto start { slot(write) };
+            const auto reserved { std::min({ count, free, capacity() - start }) };
+            for (; constructed_ahead_ < reserved; ++constructed_ahead_) {
+                ::new (data_[slot(write + constructed_ahead_)].storage_) T;
+            }
+            return { element(write), reserved };
+        }
+
+        /**
+         * @brief Publish the first count slots returned by reserveBatch() to the consumer, with a single cursor update.
+         * @param count Number of slots written, no more than the size of the reserved span
+         */
+        void commitBatch(size_t count) noexcept {
+            if (count > constructed_ahead_) [[unlikely]] {
+                utils::FATAL("Attempted to commit more elements than were reserved!");
+            }
+            constructed_ahead_ -= count;
+            const auto write { next_write_index_.load(std::memory_order_relaxed) };
+            telemetry_.onPublish(write, count, [this]() { return next_read_index_.load(std::memory_order_acquire); });
+            next_write_index_.store(write + count, std::memory_order_release);
+        }
+
+        /**
+         * @brief Get up to max_count unread elements in one go. They stay in the queue until releaseBatch() is called.
+         * Like reserveBatch(), the span is contiguous, so it stops at the end of the ring. Call again after releasing
+         * to get elements that wrapped around. Empty if there is nothing to read.
+         * @note Consumer side only.
+         * @param max_count Maximum number of elements wanted
+         * @return std::span<T> elements that can be read
+         */
+        std::span<T> peekBatch(size_t max_count = SIZE_MAX) noexcept requires (!IS_OVERWRITE) {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            if (cached_write_index_ - read < max_count) {
+                cached_write_index_ = next_write_index_.load(std::memory_order_acquire);
+            }
+            if (cached_write_index_ == read && max_count) {
+                telemetry_.onEmpty();
+            }
+            const auto start { slot(read) };
+            return { element(read), std::min({ max_count, cached_write_index_ - read, capacity() - start }) };
+        }
+
+        /**
+         * @brief Destroy the first count elements returned by peekBatch() and hand them back to the producer,
+         * with a single cursor update.
+         * @param count Number of elements consumed, no more than the size of the peeked span
          */
-        T* getNextRead() noexcept {
-            return (size_ == 0) ? 
-                nullptr : &data_[next_read_index_];
+        void releaseBatch(size_t count) noexcept requires (!IS_OVERWRITE) {
+            const auto read { next_read_index_.load(std::memory_order_relaxed) };
+            if (count > cached_write_index_ - read) [[unlikely]] {
+                utils::FATAL("Attempted to release more elements than were read!");
+            }
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                for (size_t i { 0 }; i < count; ++i) {
+                    element(read + i)->~T();
+                }
+            }
+            telemetry_.onConsume(read, count);
+            next_read_index_.store(read + count, std::memory_order_release);
         }
 
+    private:
         /**
-         * @brief Increment the read index, decrement size of the queue.
+         * @brief Map a cursor to the slot it refers to
          */
-        void updateReadIndex() noexcept {
-            next_read_index_ = (next_read_index_ + 1) % data_.size();
-            utils::ASSERT(size_ > 0, "Attempted to read from empty queue!");
-            --size_;
-        }        
-        
+        size_t slot(size_t index) const noexcept {
+            if constexpr (IS_STATIC) {
+                return index & (N - 1);
+            } else {
+                return index % capacity_;
+            }
+        }
+
+        /**
+         * @brief Element held in the slot for this cursor. Only valid while that slot is constructed.
+         */
+        T* element(size_t index) noexcept {
+            return std::launder(reinterpret_cast<T*>(data_[slot(index)].storage_));
+        }
+
+        /**
+         * @brief Make sure the slot at the write cursor is free, applying the overflow policy if it isn't.
+         * @return true if the producer can write to the slot
+         */
+        bool makeRoom() noexcept {
+            if (!full()) [[likely]] {
+                return true;
+            }
+            telemetry_.onFull(capacity());
+            if constexpr (Overflow == QueueOverflow::SPIN_UNTIL_SPACE) {
+                SpinThenYieldWait<>{}.wait([this]() { return !full(); });
+                return true;
+            } else if constexpr (Overflow == QueueOverflow::DROP_NEWEST) {
+                overflows_.store(overflows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                return false;
+            } else if constexpr (IS_OVERWRITE) {
+                // Queue is full, so the oldest element is exactly one lap behind the write cursor
+                auto read { next_write_index_.load(std::memory_order_relaxed) - capacity() };
+                if (next_read_index_.compare_exchange_strong(read, read + 1, std::memory_order_acq_rel)) {
+                    overflows_.store(overflows_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    read = read + 1;
+                }
+                // Otherwise the consumer took it first, and read now holds where the consumer got to. Either way the slot is free.
+                cached_read_index_ = read;
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        /**
+         * @brief Consumer side of OVERWRITE_OLDEST. Copy the oldest element out, then claim it by moving the read cursor on.
+         * If the producer claimed it first (and may have been overwriting it while we copied), the copy is thrown away
+         * and we try again with what is now the oldest element.
+         */
+        bool claimOldest(T& out) noexcept {
+            auto read { next_read_index_.load(std::memory_order_acquire) };
+            while (true) {
+                // The producer can move read past our cached write index, so compare rather than check for equality
+                if (read >= cached_write_index_) {
+                    cached_write_index_ = next_write_index_.load(std::memory_order_acquire);
+                    if (read >= cached_write_index_) {
+                        return false;
+                    }
+                }
+                alignas(T) std::byte copy[sizeof(T)];
+                std::memcpy(copy, data_[slot(read)].storage_, sizeof(T));
+                // On failure, read is reloaded with where the producer moved it to
+                if (next_read_index_.compare_exchange_strong(read, read + 1, std::memory_order_acq_rel)) {
+                    telemetry_.onConsume(read, 1);
+                    std::memcpy(&out, copy, sizeof(T));
+                    return true;
+                }
+            }
+        }
+
+        template<typename... Args>
+        void construct(Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args&&...>) {
+            const auto write { next_write_index_.load(std::memory_order_relaxed) };
+            // Replace a slot getNextWriteTo()/reserveBatch() handed out but that was never committed. The rest of what
+            // they constructed still starts at the write cursor once it moves on.
+            if (constructed_ahead_) {
+                element(write)->~T();
+                --constructed_ahead_;
+            }
+            ::new (data_[slot(write)].storage_) T(std::forward<Args>(args)...);
+            telemetry_.onPublish(write, 1, [this]() { return next_read_index_.load(std::memory_order_acquire); });
+            next_write_index_.store(write + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief Producer side count of free slots, based on the cached read index (so may be an underestimate)
+         */
+        size_t freeSlots(size_t write) const noexcept {
+            const auto used { write - cached_read_index_ };
+            return used < capacity() ? capacity() - used : 0;
+        }
+
+        /**
+         * @brief Consumer side check for whether there is anything at the given read index.
+         * Only goes to the producer's cache line if everything we knew about has already been read.
+         */
+        bool hasUnread(size_t read) noexcept {
+            if (read != cached_write_index_) [[likely]] {
+                return true;
+            }
+            cached_write_index_ = next_write_index_.load(std::memory_order_acquire);
+            return read != cached_write_index_;
+        }
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,113 @@
+#pragma once
+/**
+ * @file triple_buffer.hpp
+ * @brief Single writer, single reader, lock free handoff of the latest value
+ * @version 0.1
+ * @test tests/lfds/test_triple_buffer.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include "utils/constants.hpp"
+
+namespace lfds {
+
+    /**
+     * @brief Three copies of a value: one the writer owns, one the reader owns, and one in the middle holding the
+     * latest published value. Publishing swaps the writer's copy with the middle one, and picking up an update swaps the
+     * reader's copy with the middle one - one atomic exchange each, no retries, and neither side ever waits.
+     *
+     * For data where only the latest value matters (strategy parameters, risk limits, fair values): unlike an SPSCQueue
+     * the reader never works through stale updates, and unlike a SeqLock the reader never retries under a fast writer,
+     * and always reads a whole value in place.
+     *
+     * @tparam T Type of value
+     */
+    template<typename T>
+    class TripleBuffer final {
+    private:
+        // Set in middle_ when the writer published into it and the reader hasn't picked it up yet
+        static constexpr uint8_t FRESH { 0b100 };
+        static constexpr uint8_t INDEX_MASK { 0b011 };
+
+        struct alignas(utils::CACHE_LINE_SIZE) Buffer {
+            T value_;
+        };
+
+        std::array<Buffer, 3> buffers_;
+
+        // Buffer the writer is writing to. Writer only.
+        alignas(utils::CACHE_LINE_SIZE) uint8_t back_ { 0 };
+
+        // Buffer in the middle, plus FRESH. Swapped by both sides.
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<uint8_t> middle_ { 1 };
+
+        // Buffer the reader is reading from. Reader only.
+        alignas(utils::CACHE_LINE_SIZE) uint8_t front_ { 2 };
+
+    public:
+        /**
+         * @brief Create new triple buffer, the reader seeing initial until the first publish()
+         */
+        explicit TripleBuffer(const T& initial = T())
+            : buffers_ { Buffer { initial }, Buffer { initial }, Buffer { initial } }
+        {}
+
+        // Delete copy, move ctors and assignment operators
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        TripleBuffer(TripleBuffer&&) = delete;
+        TripleBuffer& operator=(TripleBuffer&&) = delete;
+
+        /**
+         * @brief Get the buffer to write the next value into, in place.
+         * @note Remember to call publish() after writing! The buffer holds an older value, not the last one published,
+         * so write the whole value, not just the fields that changed. Writer side only.
+         */
+        T& writeBuffer() noexcept {
+            return buffers_[back_].value_;
+        }
+
+        /**
+         * @brief Make the value written to writeBuffer() the latest one, replacing any the reader hasn't picked up yet.
+         */
+        void publish() noexcept {
+            // Release our writes to the reader, and acquire the reader's last reads of the buffer we get back
+            back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+        }
+
+        /**
+         * @brief Copy a value in and publish it.
+         */
+        void write(const T& value) noexcept(std::is_nothrow_copy_assignable_v<T>) {
+            writeBuffer() = value;
+            publish();
+        }
+
+        /**
+         * @brief Pick up the latest value, if one was published since the last update(). Reader side only.
+         * @return true if there was a newer value
+         */
+        bool update() noexcept {
+            if (!(middle_.load(std::memory_order_relaxed) & FRESH)) {
+                return false;
+            }
+            front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+            return true;
+        }
+
+        /**
+         * @brief Get the latest value. Stays valid, and unchanged, until the next read() or update() by the reader.
+         */
+        const T& read() noexcept {
+            update();
+            return buffers_[front_].value_;
+        }
+    };
+}
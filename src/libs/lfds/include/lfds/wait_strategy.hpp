@@ -0,0 +1,154 @@
+#pragma once
+/**
+ * @file wait_strategy.hpp
+ * @brief Ways for a consumer thread to wait for a queue to have something in it
+ * @version 0.1
+ * @test tests/lfds/test_wait_strategy.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <immintrin.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "utils/constants.hpp"
+
+namespace lfds {
+
+    /*
+     * Every wait strategy has the same two methods, so consumers can take the strategy as a template parameter:
+     *
+     *  - template<typename Condition> void wait(Condition&& ready)
+     *      Consumer side. Returns once ready() returns true. ready() is called repeatedly, so it should be cheap and
+     *      consumer side only (e.g. getNextRead() != nullptr).
+     *
+     *  - void notify()
+     *      Producer side. Call after publishing something that may make ready() true.
+     *
+     * They trade latency for CPU usage, from BusySpinWait (lowest latency, burns a whole core) to FutexWait (consumer
+     * sleeps in the kernel once it's been idle for a while, and costs the producer a fence per notify).
+     */
+
+    /**
+     * @brief Check the condition in a tight loop. Lowest wake up latency, but pegs the core, and the loop competes
+     * for execution resources with the other hyperthread on the same core. Use on an isolated, pinned core.
+     */
+    class BusySpinWait final {
+    public:
+        template<typename Condition>
+        void wait(Condition&& ready) noexcept {
+            while (!ready()) {}
+        }
+
+        void notify() noexcept {}
+    };
+
+    /**
+     * @brief Check the condition in a loop with a pause instruction between checks. The pause hints to the CPU that
+     * this is a spin loop, which frees resources for the sibling hyperthread and avoids the pipeline flush
+     * on leaving the loop. Still pegs the core.
+     */
+    class PauseSpinWait final {
+    public:
+        template<typename Condition>
+        void wait(Condition&& ready) noexcept {
+            while (!ready()) {
+                _mm_pause();
+            }
+        }
+
+        void notify() noexcept {}
+    };
+
+    /**
+     * @brief Spin with pause for a while, then give the core up to the scheduler between checks.
+     * Wakes up quickly while traffic is flowing, and lets other threads on the same core run when it isn't.
+     * @tparam SPIN_COUNT Number of checks before starting to yield
+     */
+    template<size_t SPIN_COUNT = 1024>
+    class SpinThenYieldWait final {
+    public:
+        template<typename Condition>
+        void wait(Condition&& ready) noexcept {
+            for (size_t i { 0 }; i < SPIN_COUNT; ++i) {
+                if (ready()) {
+                    return;
+                }
+                _mm_pause();
+            }
+            while (!ready()) {
+                std::this_thread::yield();
+            }
+        }
+
+        void notify() noexcept {}
+    };
+
+    /**
+     * @brief Spin with pause for a while, then park the consumer thread on a futex until a producer wakes it up.
+     * The producer only makes a system call if the consumer is actually parked - otherwise notify() is a fence and a load
+     * of a cache line that is only written when the consumer goes to sleep.
+     * @note Only one consumer thread may wait on a FutexWait at a time.
+     * @tparam SPIN_COUNT Number of checks before parking
+     */
+    template<size_t SPIN_COUNT = 1024>
+    class FutexWait final {
+    private:
+        // 1 while the consumer is (about to be) asleep in the kernel
+        alignas(utils::CACHE_LINE_SIZE) std::atomic<uint32_t> parked_ { 0 };
+
+    public:
+        FutexWait() = default;
+
+        // The futex address must stay put while a thread may be sleeping on it
+        FutexWait(const FutexWait&) = delete;
+        FutexWait& operator=(const FutexWait&) = delete;
+
+        FutexWait(FutexWait&&) = delete;
+        FutexWait& operator=(FutexWait&&) = delete;
+
+        template<typename Condition>
+        void wait(Condition&& ready) noexcept {
+            for (size_t i { 0 }; i < SPIN_COUNT; ++i) {
+                if (ready()) {
+                    return;
+                }
+                _mm_pause();
+            }
+
+            while (true) {
+                parked_.store(1, std::memory_order_relaxed);
+                // Pairs with the fence in notify(): either the producer sees parked_ == 1 and wakes us up,
+                // or we see what it published in the check below.
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (ready()) {
+                    parked_.store(0, std::memory_order_relaxed);
+                    return;
+                }
+                // Returns straight away if a producer already reset parked_ to 0
+                syscall(SYS_futex, &parked_, FUTEX_WAIT_PRIVATE, 1, nullptr, nullptr, 0);
+            }
+        }
+
+        void notify() noexcept {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (parked_.load(std::memory_order_relaxed)) [[unlikely]] {
+                parked_.store(0, std::memory_order_relaxed);
+                syscall(SYS_futex, &parked_, FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+            }
+        }
+
+        /**
+         * @brief Whether the consumer is currently parked (or about to be). Mostly useful for tests and monitoring.
+         */
+        bool parked() const noexcept {
+            return parked_.load(std::memory_order_relaxed);
+        }
+    };
+}
@@ -10,5 +10,7 @@
 #include <cstdio>
 
 namespace logger {
-    constexpr size_t LOG_QUEUE_SIZE { 8 * 1024 * 1024 };
+    // Log queue segments to allocate up front, and most drained segments to keep around after a burst
+    constexpr size_t LOG_QUEUE_INITIAL_SEGMENTS { 2 };
+    constexpr size_t LOG_QUEUE_MAX_SPARE_SEGMENTS { 16 };
 }
\ No newline at end of file
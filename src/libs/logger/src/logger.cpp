@@ -6,6 +6,7 @@
  */
 
 #include "logger/logger.hpp"
+#include <cstring>
 #include "constants.hpp"
 #include "logger/log_type.hpp"
 #include "utils/assertions.hpp"
@@ -13,7 +14,7 @@
 
 namespace logger {
     Logger::Logger(const std::string& file_name)
-        : file_name_ { file_name }, queue_ { LOG_QUEUE_SIZE } 
+        : file_name_ { file_name }, queue_ { LOG_QUEUE_INITIAL_SEGMENTS, LOG_QUEUE_MAX_SPARE_SEGMENTS }
     {
         // Attempt to load provided file name, triggering an assertion error if it fails
         file_.open(file_name, std::ios::out | std::ios::app);
@@ -28,11 +29,11 @@ namespace logger {
 
     Logger::~Logger() {
         // Wait for queue to empty
-        while (queue_.size()) {
-            std::this_thread::sleep_for(std::chrono::seconds { 1 });
-        }
-        // Set running to false and wait for thread to finish up
+        lfds::SpinThenYieldWait<>{}.wait([this]() { return queue_.size() == 0; });
+
+        // Set running to false, wake the thread up if it's parked and wait for it to finish up
         running_ = false;
+        queue_wait_.notify();
         logger_thread_.join();
 
         file_.close();
@@ -52,59 +53,69 @@ namespace logger {
             pushValue(prefix_);
         }
             while (*str) {
+                // Push everything up to the next % (or the end) in one batch
+                const char* run { str };
+                while (*str && *str != '%') {
+                    ++str;
+                }
+                pushValue(run, str - run);
+
                 if (*str == '%') {
-                    if (*(str + 1) == '%') [[unlikely]] {
-                        ++str;
-                    } else {
-                        return;
+                    if (*(str + 1) != '%') {
+                        // Nothing to substitute in, stop here
+                        break;
                     }
+                    ++str;
+                    pushValue(*str++);
                 }
-                pushValue(*str++);
             }
+            queue_wait_.notify();
         }
 
     void Logger::consumeQueue() noexcept {
         while (running_) {
-            for (auto next { queue_.getNextRead() }; queue_.size() && next; next = queue_.getNextRead()) {
-                switch (next->type_) {
-                    case LogType::CHAR:
-                        file_ << next->u_.c; break;
-                    case LogType::INTEGER:
-                        file_ << next->u_.i; break;
-                    case LogType::LONG_INTEGER:
-                        file_ << next->u_.l; break;
-                    case LogType::LONG_LONG_INTEGER:
-                        file_ << next->u_.ll; break;
-                    case LogType::UNSIGNED_INTEGER:
-                        file_ << next->u_.u; break;
-                    case LogType::UNSIGNED_LONG_INTEGER:
-                        file_ << next->u_.ul; break;
-                    case LogType::UNSIGNED_LONG_LONG_INTEGER:
-                        file_ << next->u_.ull; break;
-                    case LogType::FLOAT: 
-                        file_ << next->u_.f; break;
-                    case LogType::DOUBLE: 
-                        file_ << next->u_.d; break;
+            for (auto batch { queue_.peekBatch() }; !batch.empty(); batch = queue_.peekBatch()) {
+                for (const auto& next : batch) {
+                    switch (next.type_) {
+                        case LogType::CHAR:
+                            file_ << next.u_.c; break;
+                        case LogType::INTEGER:
+                            file_ << next.u_.i; break;
+                        case LogType::LONG_INTEGER:
+                            file_ << next.u_.l; break;
+                        case LogType::LONG_LONG_INTEGER:
+                            file_ << next.u_.ll; break;
+                        case LogType::UNSIGNED_INTEGER:
+                            file_ << next.u_.u; break;
+                        case LogType::UNSIGNED_LONG_INTEGER:
+                            file_ << next.u_.ul; break;
+                        case LogType::UNSIGNED_LONG_LONG_INTEGER:
+                            file_ << next.u_.ull; break;
+                        case LogType::FLOAT: 
+                            file_ << next.u_.f; break;
+                        case LogType::DOUBLE: 
+                            file_ << next.u_.d; break;
+                    }
                 }
-                // Done processing this element, update read index
-                queue_.updateReadIndex();
-                next = queue_.getNextRead();
+                // Done processing this batch, hand it back to the producer in one go
+                queue_.releaseBatch(batch.size());
             }
-            // Ran out of elements, let's wait before checking again.
-            std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+            // Ran out of elements, wait for more (or for the logger to be shut down)
+            queue_wait_.wait([this]() { return queue_.size() != 0 || !running_; });
         }
     }
 
     void Logger::flushQueue() noexcept {
-        while (queue_.size()) {
-            std::this_thread::sleep_for(std::chrono::seconds { 1 });
-        }
+        lfds::SpinThenYieldWait<>{}.wait([this]() { return queue_.size() == 0; });
         file_.flush();
     }
     
+    lfds::QueueStats Logger::queueStats() const noexcept {
+        return queue_.stats();
+    }
+
     void Logger::pushValue(const LogElement& element) noexcept {
-        *(queue_.getNextWriteTo()) = element;
-        queue_.updateWriteIndex();
+        queue_.push(element);
     }
 
     void Logger::pushValue(const char ch) noexcept {
@@ -112,14 +123,23 @@ namespace logger {
     }
 
     void Logger::pushValue(const char* cstr) noexcept {
-        while (*cstr) {
-            pushValue(*cstr);
-            ++cstr;
+        pushValue(cstr, std::strlen(cstr));
+    }
+
+    void Logger::pushValue(const char* cstr, size_t len) noexcept {
+        while (len) {
+            // Batch may be cut short by the end of a segment - keep going until all characters are in
+            auto batch { queue_.reserveBatch(len) };
+            for (auto& element : batch) {
+                element = LogElement { LogType::CHAR, { .c = *cstr++ } };
+            }
+            queue_.commitBatch(batch.size());
+            len -= batch.size();
         }
     }
 
     void Logger::pushValue(const std::string& str) noexcept {
-        pushValue(str.c_str());
+        pushValue(str.data(), str.size());
     }
 
     void Logger::pushValue(const int value) noexcept {
@@ -7,6 +7,7 @@
 
 #include "networking/tcp_socket.hpp"
 #include "logger/logger.hpp"
+#include "utils/mempool/slab_allocator.hpp"
 
 namespace networking {
     constexpr int MAX_EVENTS { 1024 };
@@ -121,6 +122,11 @@ namespace networking {
 
         logger::Logger& logger_;
 
+        /**
+         * @brief Client sockets are allocated from here, so accepting a connection doesn't go to malloc
+         */
+        utils::SlabAllocator<> allocator_;
+
     private:
         bool addToEpollList(TCPSocket* socket);
         bool removeFromEpollList(TCPSocket* socket);
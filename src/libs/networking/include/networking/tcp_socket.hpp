@@ -9,10 +9,18 @@
 #include "socket_utils.hpp"
 #include "logger/logger.hpp"
 #include "utils/time.hpp"
+#include "utils/memory.hpp"
 
 namespace networking {
     constexpr size_t BUFFER_SIZE { 64 * 1024 * 1024 };
 
+    /**
+     * @brief Where socket buffers come from. Huge pages, pre-faulted at construction, so traffic on the socket
+     * doesn't take TLB misses or first touch page faults.
+     */
+    using SocketBufferMemory = utils::HugePageMemory<>;
+    using SocketBuffer = std::unique_ptr<char[], utils::MemoryDeleter<SocketBufferMemory>>;
+
     class TCPSocket;
 
     /**
@@ -47,14 +55,14 @@ namespace networking {
          * @brief Pointer to character buffer for sending data, and the next index up to which valid data 
          * has been written and can be sent.
          */
-        std::unique_ptr<char[]> send_buf_ { nullptr };
+        SocketBuffer send_buf_ { nullptr };
         size_t next_send_valid_index_ { 0 };
 
         /**
          * @brief Pointer to recieve buffer for recieving data, and the next index up to which valid data
          * has been recieved and can be read.
          */
-        std::unique_ptr<char[]> recv_buf_ { nullptr };
+        SocketBuffer recv_buf_ { nullptr };
         size_t next_rcv_valid_index_ { 0 };
         
         /**
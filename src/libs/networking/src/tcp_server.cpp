@@ -35,8 +35,12 @@ namespace networking {
         listener_socket_.destroy();
         for (auto socket : sockets_) {
             socket->destroy();
-            delete socket;
+            allocator_.destroy(socket);
         }
+        sockets_.clear();
+        receive_sockets_.clear();
+        send_sockets_.clear();
+        disconnected_sockets_.clear();
     }
 
     TCPServer::~TCPServer() {
@@ -174,7 +178,7 @@ namespace networking {
                 logger_.log("%:% %() % New connection accepted on listener:% new socket:%\n", __FILE__, __LINE__,
                     __FUNCTION__, utils::getCurrentTimeStr(time_str_), listener_socket_.fd_, incoming_fd);
                 
-                TCPSocket* client { new TCPSocket { logger_ } };
+                TCPSocket* client { allocator_.create<TCPSocket>(logger_) };
                 client->fd_ = incoming_fd;
                 client->recv_callback_ = recv_callback_;
 
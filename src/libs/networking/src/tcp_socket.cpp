@@ -14,10 +14,14 @@ namespace networking {
         socket->fd_, socket->next_rcv_valid_index_, rx_time);
     }
 
+    static SocketBuffer allocateBuffer() {
+        return SocketBuffer { static_cast<char*>(SocketBufferMemory::allocate(BUFFER_SIZE)), { BUFFER_SIZE } };
+    }
+
     TCPSocket::TCPSocket(logger::Logger& logger)
         : logger_ { logger } {
-        send_buf_ = std::make_unique<char[]>(BUFFER_SIZE);
-        recv_buf_ = std::make_unique<char[]>(BUFFER_SIZE);
+        send_buf_ = allocateBuffer();
+        recv_buf_ = allocateBuffer();
 
         recv_callback_ = [this](TCPSocket* socket, utils::Nanos rx_time) {
             defaultRecvSocketCallback(socket, rx_time);
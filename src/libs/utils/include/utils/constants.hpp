@@ -0,0 +1,29 @@
+#pragma once
+/**
+ * @file constants.hpp
+ * @brief Hardware related constants shared across the system
+ * @version 0.1
+ * @copyright Copyright (c) 2023
+ */
+
+#include <cstddef>
+
+namespace utils {
+    /**
+     * @brief Size of a cache line on the x86 systems we target. Data written by different threads
+     * should be aligned to this to avoid false sharing.
+     */
+    constexpr size_t CACHE_LINE_SIZE { 64 };
+
+    /**
+     * @brief Regular and (2MB, x86) huge page sizes.
+     */
+    constexpr size_t REGULAR_PAGE_SIZE { 4096 };
+    constexpr size_t HUGE_PAGE_SIZE { 2 * 1024 * 1024 };
+
+    /**
+     * @brief Capacity template argument for containers that can either have their size fixed at compile time,
+     * or supplied at runtime. Passing this means the size is given to the constructor.
+     */
+    constexpr size_t DYNAMIC_CAPACITY { 0 };
+}
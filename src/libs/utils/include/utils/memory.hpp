@@ -0,0 +1,149 @@
+#pragma once
+/**
+ * @file memory.hpp
+ * @brief Memory providers for large, long lived regions (queues, pools, buffers), and adaptors to plug them into containers
+ * @version 0.1
+ * @test tests/utils/memory_test.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+#include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+
+namespace utils {
+
+    /*
+     * A memory provider is a type with two static methods:
+     *
+     *  - static void* allocate(size_t bytes)
+     *      Returns at least bytes of memory, aligned to at least CACHE_LINE_SIZE. Asserts on failure.
+     *
+     *  - static void deallocate(void* ptr, size_t bytes)
+     *      Returns memory from allocate(), given the same size.
+     *
+     * Containers take the provider as a template parameter, so the choice costs nothing at runtime.
+     */
+
+    /**
+     * @brief Regular heap memory. Pages are only faulted in when first touched.
+     */
+    class HeapMemory final {
+    public:
+        static void* allocate(size_t bytes) {
+            return ::operator new(bytes, std::align_val_t { CACHE_LINE_SIZE });
+        }
+
+        static void deallocate(void* ptr, size_t) noexcept {
+            ::operator delete(ptr, std::align_val_t { CACHE_LINE_SIZE });
+        }
+    };
+
+    /**
+     * @brief Memory backed by huge pages, so a large region takes a handful of TLB entries instead of thousands.
+     * Tries explicit huge pages (MAP_HUGETLB) first, which needs pages reserved in /proc/sys/vm/nr_hugepages. If there
+     * aren't enough, falls back to a regular mapping aligned to the huge page size and advised for transparent huge pages,
+     * which the kernel backs with huge pages when it can.
+     * @tparam PREFAULT Fault every page in at allocation, so the hot path never takes a first touch page fault.
+     * @tparam LOCK mlock() the region so it can never be swapped out. Needs RLIMIT_MEMLOCK to allow it - if it doesn't,
+     * the memory is still usable, just not locked.
+     */
+    template<bool PREFAULT = true, bool LOCK = false>
+    class HugePageMemory final {
+    public:
+        static void* allocate(size_t bytes) {
+            const auto length { mappingLength(bytes) };
+
+            void* ptr { mmap(nullptr, length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (PREFAULT ? MAP_POPULATE : 0), -1, 0) };
+            if (ptr == MAP_FAILED) {
+                ptr = mapTransparent(length);
+            }
+
+            if constexpr (LOCK) {
+                mlock(ptr, length);
+            }
+            return ptr;
+        }
+
+        static void deallocate(void* ptr, size_t bytes) noexcept {
+            munmap(ptr, mappingLength(bytes));
+        }
+
+    private:
+        static size_t mappingLength(size_t bytes) noexcept {
+            return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        }
+
+        static void* mapTransparent(size_t length) {
+            // Over map by a huge page, then trim, so the region starts on a huge page boundary
+            void* raw { mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) };
+            ASSERT(raw != MAP_FAILED, "Failed to map memory.");
+
+            const auto raw_start { reinterpret_cast<uintptr_t>(raw) };
+            const auto start { (raw_start + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE };
+            if (start != raw_start) {
+                munmap(raw, start - raw_start);
+            }
+            if (const auto tail { raw_start + HUGE_PAGE_SIZE - start }) {
+                munmap(reinterpret_cast<void*>(start + length), tail);
+            }
+
+            void* ptr { reinterpret_cast<void*>(start) };
+            madvise(ptr, length, MADV_HUGEPAGE);
+
+            if constexpr (PREFAULT) {
+                // Touch every page after advising, so the faults are taken now, and as huge pages where possible
+                auto bytes { static_cast<volatile char*>(ptr) };
+                for (size_t offset { 0 }; offset < length; offset += REGULAR_PAGE_SIZE) {
+                    bytes[offset] = 0;
+                }
+            }
+            return ptr;
+        }
+    };
+
+    /**
+     * @brief Deleter for std::unique_ptr holding memory from a provider.
+     * Objects in the memory must already have been destroyed - this just hands the memory back.
+     */
+    template<typename Memory>
+    struct MemoryDeleter {
+        size_t bytes_ { 0 };
+
+        void operator()(void* ptr) const noexcept {
+            Memory::deallocate(ptr, bytes_);
+        }
+    };
+
+    /**
+     * @brief Standard library allocator that gets its memory from a provider, e.g. for a std::vector.
+     */
+    template<typename T, typename Memory>
+    struct MemoryAllocator {
+        using value_type = T;
+
+        MemoryAllocator() noexcept = default;
+
+        template<typename U>
+        MemoryAllocator(const MemoryAllocator<U, Memory>&) noexcept {}
+
+        T* allocate(size_t count) {
+            return static_cast<T*>(Memory::allocate(count * sizeof(T)));
+        }
+
+        void deallocate(T* ptr, size_t count) noexcept {
+            Memory::deallocate(ptr, count * sizeof(T));
+        }
+
+        template<typename U>
+        bool operator==(const MemoryAllocator<U, Memory>&) const noexcept {
+            return true;
+        }
+    };
+}
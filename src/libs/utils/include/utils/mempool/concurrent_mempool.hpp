@@ -0,0 +1,249 @@
+#pragma once
+/**
+ * @file concurrent_mempool.hpp
+ * @brief Memory pool that objects can be allocated from and returned to on any thread, lock free
+ * @version 0.1
+ * @test tests/utils/concurrent_mempool_test.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include "utils/assertions.hpp"
+#include "utils/memory.hpp"
+
+namespace utils {
+
+    /**
+     * @brief Fixed size pool of T that any thread can allocate from, and any thread can return objects to - e.g. an
+     * order allocated on the strategy thread and freed on the gateway thread once it's acked.
+     *
+     * Free blocks are kept on a lock free stack (Treiber stack), linked by 32 bit block index rather than by pointer.
+     * The head packs that index together with a tag that's bumped on every change, so a thread that read the head, got
+     * preempted, and then CASes it after other threads popped and pushed the same block back, fails instead of
+     * corrupting the stack (the ABA problem).
+     *
+     * Every thread that allocates or frees often should go through its own Cache. A cache keeps a magazine of free
+     * blocks, so most operations don't touch shared state at all. It only goes to the shared stack to refill or
+     * spill half a magazine at a time, with a single CAS either way.
+     *
+     * @tparam T Type of object held in pool
+     * @tparam MAGAZINE_SIZE Free blocks each Cache holds at most
+     * @tparam Memory Where the pool's memory comes from, see utils/memory.hpp
+     */
+    template<typename T, size_t MAGAZINE_SIZE = 64, typename Memory = HeapMemory>
+    class ConcurrentMemPool final {
+    private:
+        static_assert(MAGAZINE_SIZE >= 2, "ConcurrentMemPool magazine must hold at least two blocks");
+
+        static constexpr uint32_t NO_BLOCK { UINT32_MAX };
+
+        struct Block {
+            alignas(T) std::byte storage_[sizeof(T)];
+            // Next free block. Atomic, as a thread popping the stack may read it while the block is being handed out.
+            std::atomic<uint32_t> next_ { NO_BLOCK };
+        };
+
+        const size_t size_;
+        const std::unique_ptr<Block[], MemoryDeleter<Memory>> data_;
+
+        // Top of the free stack: tag in the high 32 bits, block index in the low 32 bits
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head_;
+
+    public:
+        /**
+         * @brief One thread's magazine of free blocks. Must only be used from one thread at a time.
+         * Returns its blocks to the pool when destroyed.
+         */
+        class Cache final {
+        private:
+            ConcurrentMemPool* pool_;
+            std::array<uint32_t, MAGAZINE_SIZE> blocks_;
+            size_t count_ { 0 };
+
+        public:
+            explicit Cache(ConcurrentMemPool& pool) noexcept
+                : pool_ { &pool }
+            {}
+
+            ~Cache() {
+                if (pool_ && count_) {
+                    spill(count_);
+                }
+            }
+
+            Cache(const Cache&) = delete;
+            Cache& operator=(const Cache&) = delete;
+
+            Cache(Cache&& other) noexcept
+                : pool_ { std::exchange(other.pool_, nullptr) }, blocks_ { other.blocks_ }, count_ { std::exchange(other.count_, 0) }
+            {}
+
+            Cache& operator=(Cache&&) = delete;
+
+            /**
+             * @brief Allocate a new object from this thread's magazine, refilling it from the pool if it's empty.
+             * @param args arguments forwarded to ctor of object being allocated
+             * @return Pointer to new object
+             */
+            template<typename... Args>
+            T* allocate(Args&&... args) noexcept {
+                if (!count_) [[unlikely]] {
+                    count_ = pool_->popChain(blocks_.data(), MAGAZINE_SIZE / 2);
+                    ASSERT(count_, "Memory pool out of space.");
+                }
+                return pool_->construct(blocks_[--count_], std::forward<Args>(args)...);
+            }
+
+            /**
+             * @brief Destroy an object from the pool, which may have been allocated on any thread, and keep its block
+             * in this thread's magazine. If the magazine is full, half of it goes back to the pool first.
+             */
+            void deallocate(const T* elem) noexcept {
+                const auto index { pool_->destroy(elem) };
+                if (count_ == MAGAZINE_SIZE) [[unlikely]] {
+                    spill(MAGAZINE_SIZE / 2);
+                }
+                blocks_[count_++] = index;
+            }
+
+        private:
+            /**
+             * @brief Return the top count blocks of the magazine to the pool
+             */
+            void spill(size_t count) noexcept {
+                count_ -= count;
+                pool_->pushChain(&blocks_[count_], count);
+            }
+        };
+
+        /**
+         * @brief Create a new pool. Memory for every block is allocated up front, but no objects are constructed.
+         * @param size Number of elements (of type T) in pool
+         */
+        explicit ConcurrentMemPool(size_t size)
+            : size_ { size }, data_ { static_cast<Block*>(Memory::allocate(size * sizeof(Block))), { size * sizeof(Block) } }
+        {
+            ASSERT(size > 0 && size < NO_BLOCK, "ConcurrentMemPool size must fit in a 32 bit index.");
+            for (size_t i { 0 }; i < size; ++i) {
+                ::new (&data_[i]) Block {};
+                data_[i].next_.store(i + 1 < size ? static_cast<uint32_t>(i + 1) : NO_BLOCK, std::memory_order_relaxed);
+            }
+            head_.store(0, std::memory_order_release);
+        }
+
+        // Delete default ctor, copy ctor/assignment, move ctor/assigment as they don't make sense for a memory pool.
+        ConcurrentMemPool() = delete;
+
+        ConcurrentMemPool(const ConcurrentMemPool&) = delete;
+        ConcurrentMemPool& operator=(const ConcurrentMemPool&) = delete;
+
+        ConcurrentMemPool(ConcurrentMemPool&&) = delete;
+        ConcurrentMemPool& operator=(ConcurrentMemPool&&) = delete;
+
+        /**
+         * @brief Create a magazine for the calling thread to allocate and free through.
+         */
+        Cache cache() noexcept {
+            return Cache { *this };
+        }
+
+        size_t capacity() const noexcept {
+            return size_;
+        }
+
+        /**
+         * @brief Allocate a new object straight from the shared free stack, for threads that don't keep a Cache.
+         * @param args arguments forwarded to ctor of object being allocated
+         * @return Pointer to new object
+         */
+        template<typename... Args>
+        T* allocate(Args&&... args) noexcept {
+            uint32_t index;
+            ASSERT(popChain(&index, 1), "Memory pool out of space.");
+            return construct(index, std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Destroy an object from the pool and push its block straight back onto the shared free stack.
+         * @param elem Pointer to the element to be deallocated, allocated on any thread
+         */
+        void deallocate(const T* elem) noexcept {
+            const auto index { destroy(elem) };
+            pushChain(&index, 1);
+        }
+
+    private:
+        static uint64_t pack(uint64_t tag, uint32_t index) noexcept {
+            return tag << 32 | index;
+        }
+
+        static uint32_t indexOf(uint64_t head) noexcept {
+            return static_cast<uint32_t>(head);
+        }
+
+        static uint64_t tagOf(uint64_t head) noexcept {
+            return head >> 32;
+        }
+
+        template<typename... Args>
+        T* construct(uint32_t index, Args&&... args) noexcept {
+            return ::new (data_[index].storage_) T(std::forward<Args>(args)...);
+        }
+
+        uint32_t destroy(const T* elem) noexcept {
+            const auto index { reinterpret_cast<const Block*>(elem) - data_.get() };
+
+            // If the given pointer doesn't point to an element within the pool, this index will be out of bounds
+            ASSERT(index >= 0 && static_cast<size_t>(index) < size_, "Pointer provided doesn't point to something in this pool.");
+
+            std::launder(const_cast<T*>(elem))->~T();
+            return static_cast<uint32_t>(index);
+        }
+
+        /**
+         * @brief Pop up to count blocks off the free stack with one CAS.
+         * The links walked can be changed under us, but only by a thread that has changed the head (and so its tag)
+         * first - in which case the CAS fails and we walk again.
+         * @return Number of blocks popped into out
+         */
+        size_t popChain(uint32_t* out, size_t count) noexcept {
+            auto head { head_.load(std::memory_order_acquire) };
+            while (true) {
+                size_t popped { 0 };
+                auto next { indexOf(head) };
+                while (popped < count && next != NO_BLOCK) {
+                    out[popped++] = next;
+                    next = data_[next].next_.load(std::memory_order_relaxed);
+                }
+                if (!popped) {
+                    return 0;
+                }
+                if (head_.compare_exchange_weak(head, pack(tagOf(head) + 1, next), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    return popped;
+                }
+            }
+        }
+
+        /**
+         * @brief Link count blocks together and push them onto the free stack with one CAS.
+         */
+        void pushChain(const uint32_t* blocks, size_t count) noexcept {
+            for (size_t i { 0 }; i + 1 < count; ++i) {
+                data_[blocks[i]].next_.store(blocks[i + 1], std::memory_order_relaxed);
+            }
+            auto& last { data_[blocks[count - 1]].next_ };
+            auto head { head_.load(std::memory_order_relaxed) };
+            do {
+                last.store(indexOf(head), std::memory_order_relaxed);
+            } while (!head_.compare_exchange_weak(head, pack(tagOf(head) + 1, blocks[0]), std::memory_order_release, std::memory_order_relaxed));
+        }
+    };
+}
@@ -0,0 +1,317 @@
+#pragma once
+/**
+ * @file growable_mempool.hpp
+ * @brief Memory pool that grows a chunk at a time without ever moving allocated objects
+ * @version 0.1
+ * @test tests/utils/growable_mempool_test.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include "utils/assertions.hpp"
+#include "utils/memory.hpp"
+#include "utils/threads/threads.hpp"
+
+namespace utils {
+
+    /**
+     * @brief Memory pool made of fixed size chunks. Growing adds a chunk and never moves the ones already there, so
+     * pointers from allocate() stay valid for as long as the object lives - unlike MemPool::resize().
+     *
+     * Size it for a normal day with the initial chunks, and let it grow on a busy one. Chunks can be reserved up front
+     * with reserve(), or added off the hot path by a background grower thread (see startGrower()). The grower is woken
+     * when the share of the pool in use passes the high water mark, so the next chunk is normally ready before it's
+     * needed. If the pool does run dry first, allocate() adds a chunk itself rather than failing.
+     *
+     * Allocation and deallocation are O(1) pops and pushes on an intrusive free list, as in MemPool, and must happen
+     * on one thread (the owner). Only growing can happen on other threads.
+     * @tparam T Type of object held in pool
+     * @tparam CHUNK_SIZE Number of elements added each time the pool grows
+     * @tparam Memory Where the pool's memory comes from, see utils/memory.hpp
+     */
+    template<typename T, size_t CHUNK_SIZE = 4096, typename Memory = HeapMemory>
+    class GrowableMemPool final {
+    private:
+        static_assert(CHUNK_SIZE > 0, "GrowableMemPool chunks must hold at least one element");
+
+        struct Block {
+            // Holds a T while allocated, or a pointer to the next free block while free
+            alignas(T) alignas(Block*) std::byte storage_[std::max(sizeof(T), sizeof(Block*))];
+        };
+
+        static constexpr size_t CHUNK_BYTES { CHUNK_SIZE * sizeof(Block) };
+
+        const size_t max_chunks_;
+        const double high_water_;
+
+        // Every chunk ever added. Sized for max_chunks_ up front, so it never moves while the owner reads it.
+        const std::unique_ptr<Block*[]> chunks_;
+
+        // Chunks added so far. Written by whoever grows the pool, under grow_mutex_.
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> published_ { 0 };
+        std::mutex grow_mutex_;
+
+        enum class GrowerState : uint8_t {
+            IDLE,
+            // Set by the owner to wake the grower, cleared by the grower once it's added a chunk
+            REQUESTED,
+            // Set by the destructor, never cleared
+            STOP
+        };
+
+        // Request and stop share one atomic, so the grower clearing a request can't also clear a stop
+        alignas(CACHE_LINE_SIZE) std::atomic<GrowerState> grower_state_ { GrowerState::IDLE };
+        std::function<void()> grower_body_ { [this]() { growLoop(); } };
+        std::thread grower_;
+
+        // Owner state
+        alignas(CACHE_LINE_SIZE) Block* free_head_ { nullptr };
+        size_t linked_ { 0 };
+        size_t allocated_ { 0 };
+        // Number of allocated objects at which the high water mark is passed
+        size_t grow_at_ { 0 };
+
+    public:
+        /**
+         * @brief Create a new pool. Memory for the initial chunks is allocated up front, but no objects are constructed.
+         * @param initial_chunks Chunks of CHUNK_SIZE elements to start with
+         * @param max_chunks Most chunks the pool can grow to
+         * @param high_water Fraction of the pool in use (0 to 1] at which the grower adds another chunk
+         */
+        explicit GrowableMemPool(size_t initial_chunks, size_t max_chunks = 1024, double high_water = 0.75)
+            : max_chunks_ { max_chunks }, high_water_ { high_water }, chunks_ { new Block*[max_chunks] {} }
+        {
+            ASSERT(initial_chunks > 0 && initial_chunks <= max_chunks, "GrowableMemPool must start with between 1 and max_chunks chunks.");
+            ASSERT(high_water > 0.0 && high_water <= 1.0, "GrowableMemPool high water mark must be in (0, 1].");
+            reserve(initial_chunks * CHUNK_SIZE);
+            linkPublished();
+        }
+
+        /**
+         * @brief Stops the grower, destroys any objects still allocated, and frees every chunk.
+         */
+        ~GrowableMemPool() {
+            if (grower_.joinable()) {
+                grower_state_.store(GrowerState::STOP, std::memory_order_release);
+                grower_state_.notify_one();
+                grower_.join();
+            }
+            destroyAllocated();
+
+            const auto chunks { published_.load(std::memory_order_acquire) };
+            for (size_t chunk { 0 }; chunk < chunks; ++chunk) {
+                Memory::deallocate(chunks_[chunk], CHUNK_BYTES);
+            }
+        }
+
+        // Delete default ctor, copy ctor/assignment, move ctor/assigment as they don't make sense for a memory pool.
+        GrowableMemPool() = delete;
+
+        GrowableMemPool(const GrowableMemPool&) = delete;
+        GrowableMemPool& operator=(const GrowableMemPool&) = delete;
+
+        GrowableMemPool(GrowableMemPool&&) = delete;
+        GrowableMemPool& operator=(GrowableMemPool&&) = delete;
+
+        /**
+         * @brief Start a background thread that adds a chunk whenever the pool passes its high water mark.
+         * @param core_id Core to pin the grower to, or -1 to leave it unpinned. Best kept off the owner's core.
+         */
+        void startGrower(int core_id = -1) {
+            ASSERT(!grower_.joinable(), "GrowableMemPool grower already started.");
+            grower_ = threads::createAndStart(core_id, "MemPool grower", grower_body_);
+            ASSERT(grower_.joinable(), "Failed to start GrowableMemPool grower.");
+        }
+
+        /**
+         * @brief Add chunks until the pool can hold at least size elements. Safe to call from any thread - e.g. at
+         * startup, or ahead of a known busy period. The owner picks new chunks up when it next needs them.
+         * @return false if that would take more than max_chunks
+         */
+        bool reserve(size_t size) {
+            const auto chunks { (size + CHUNK_SIZE - 1) / CHUNK_SIZE };
+            while (published_.load(std::memory_order_acquire) < chunks) {
+                if (!grow()) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Allocate a new object from the pool.
+         * @param args arguments forwarded to ctor of object being allocated
+         * @return Pointer to new object. Stays valid until it's deallocated, however much the pool grows.
+         */
+        template<typename... Args>
+        T* allocate(Args&&... args) noexcept {
+            if (!free_head_) [[unlikely]] {
+                refill();
+            }
+            const auto block { free_head_ };
+            free_head_ = nextFree(block);
+
+            if (++allocated_ >= grow_at_) [[unlikely]] {
+                onHighWater();
+            }
+
+            // Construct new T, forwarding arguments, directly inside the block
+            return ::new (block->storage_) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Destroy an object from the pool and return its block to the free list.
+         * @param elem Pointer to the element to be deallocated
+         * @note Debug builds check the pointer came from this pool, which takes a search through the chunks.
+         */
+        void deallocate(const T* elem) noexcept {
+            // T is at the start of its block, so the pointer is also a pointer to the block
+            const auto block { reinterpret_cast<Block*>(const_cast<T*>(elem)) };
+#ifndef NDEBUG
+            ASSERT(owns(block), "Pointer provided doesn't point to something in this pool.");
+#endif
+            std::launder(const_cast<T*>(elem))->~T();
+            setNextFree(block, free_head_);
+            free_head_ = block;
+            --allocated_;
+        }
+
+        /**
+         * @brief Number of elements the pool has room for, including chunks added but not yet picked up by the owner
+         */
+        size_t capacity() const noexcept {
+            return published_.load(std::memory_order_acquire) * CHUNK_SIZE;
+        }
+
+        /**
+         * @brief Number of objects currently allocated. Owner only.
+         */
+        size_t allocated() const noexcept {
+            return allocated_;
+        }
+
+        size_t chunks() const noexcept {
+            return published_.load(std::memory_order_acquire);
+        }
+
+    private:
+        static Block* nextFree(const Block* block) noexcept {
+            return *std::launder(reinterpret_cast<Block* const*>(block->storage_));
+        }
+
+        static void setNextFree(Block* block, Block* next) noexcept {
+            ::new (block->storage_) Block* { next };
+        }
+
+        /**
+         * @brief Add one chunk, its blocks already linked into a free list, and publish it for the owner to pick up.
+         * @return false if the pool already has max_chunks
+         */
+        bool grow() {
+            std::lock_guard lock { grow_mutex_ };
+            const auto chunk { published_.load(std::memory_order_relaxed) };
+            if (chunk == max_chunks_) {
+                return false;
+            }
+
+            const auto blocks { static_cast<Block*>(Memory::allocate(CHUNK_BYTES)) };
+            for (size_t i { 0 }; i < CHUNK_SIZE; ++i) {
+                setNextFree(&blocks[i], i + 1 < CHUNK_SIZE ? &blocks[i + 1] : nullptr);
+            }
+            chunks_[chunk] = blocks;
+            published_.store(chunk + 1, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief Splice chunks published since we last looked onto the free list. Owner only.
+         */
+        void linkPublished() noexcept {
+            const auto published { published_.load(std::memory_order_acquire) };
+            for (; linked_ < published; ++linked_) {
+                const auto blocks { chunks_[linked_] };
+                setNextFree(&blocks[CHUNK_SIZE - 1], free_head_);
+                free_head_ = blocks;
+            }
+            grow_at_ = linked_ == max_chunks_ ? SIZE_MAX : static_cast<size_t>(high_water_ * linked_ * CHUNK_SIZE);
+        }
+
+        /**
+         * @brief Free list is empty. Pick up any new chunks, or grow right here if the grower hasn't kept up.
+         */
+        void refill() noexcept {
+            linkPublished();
+            if (!free_head_) {
+                grow();
+                linkPublished();
+            }
+            if (!free_head_) [[unlikely]] {
+                FATAL("Memory pool out of space.");
+            }
+        }
+
+        void onHighWater() noexcept {
+            linkPublished();
+            auto idle { GrowerState::IDLE };
+            if (allocated_ >= grow_at_ && grower_state_.load(std::memory_order_relaxed) == idle
+                && grower_state_.compare_exchange_strong(idle, GrowerState::REQUESTED, std::memory_order_release)) {
+                grower_state_.notify_one();
+            }
+        }
+
+        void growLoop() {
+            while (true) {
+                grower_state_.wait(GrowerState::IDLE, std::memory_order_acquire);
+                if (grower_state_.load(std::memory_order_acquire) == GrowerState::STOP) {
+                    return;
+                }
+                grow();
+                // Only clear the request we just served. If the destructor stopped us meanwhile, this fails and
+                // the next wait() returns straight away.
+                auto requested { GrowerState::REQUESTED };
+                grower_state_.compare_exchange_strong(requested, GrowerState::IDLE, std::memory_order_release,
+                    std::memory_order_relaxed);
+            }
+        }
+
+        bool owns(const Block* block) const noexcept {
+            const auto chunks { published_.load(std::memory_order_acquire) };
+            for (size_t chunk { 0 }; chunk < chunks; ++chunk) {
+                if (block >= chunks_[chunk] && block < chunks_[chunk] + CHUNK_SIZE) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void destroyAllocated() {
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                std::unordered_set<const Block*> free;
+                for (auto block { free_head_ }; block; block = nextFree(block)) {
+                    free.insert(block);
+                }
+                for (size_t chunk { 0 }; chunk < linked_; ++chunk) {
+                    for (size_t i { 0 }; i < CHUNK_SIZE; ++i) {
+                        if (!free.contains(&chunks_[chunk][i])) {
+                            std::launder(reinterpret_cast<T*>(chunks_[chunk][i].storage_))->~T();
+                        }
+                    }
+                }
+            }
+        }
+    };
+}
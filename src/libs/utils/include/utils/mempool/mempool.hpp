@@ -1,55 +1,148 @@
 #pragma once
 /**
  * @file mempool.h
- * @brief Dynamically allocated memory pool class
+ * @brief Memory pool class, dynamically allocated or with inline storage
  * @version 0.1
  * @date 2023-08-13
  * @test tests/utils/mempool_test.cpp
- * 
+ *
  * @copyright Copyright (c) 2023
- * 
+ *
  */
 
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstddef>
 #include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <string>
 #include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+#include "utils/memory.hpp"
 
 namespace utils {
 
     /**
-     * @brief Dynamically allocated memory pool. A large amount of memory is allocated up front, during construction.
-     * Then, you can request chunks of memory from the pool, and this will be much faster as the memory has already been allocated.
-     * @tparam T Type of object held in pool, must have a default constructor
+     * @brief Compact reference to an object in a MemPool: the object's 32 bit index in the pool, so half the size of a
+     * pointer. For links between pooled objects in hot structures, e.g. book levels and intrusive order lists.
+     * Turned back into a pointer with MemPool::get(), which is an index into the pool's array.
+     *
+     * In debug builds a handle also carries the generation of the block it refers to, which changes every time the
+     * block is allocated or freed, so using a handle after its object was deallocated is caught.
+     * @tparam T Type of object referred to
      */
     template<typename T>
+    class Handle final {
+    private:
+        template<typename, size_t, typename, bool>
+        friend class MemPool;
+
+        static constexpr uint32_t NONE { UINT32_MAX };
+
+        uint32_t index_ { NONE };
+#ifndef NDEBUG
+        uint32_t generation_ { 0 };
+#endif
+
+    public:
+        /**
+         * @brief Create a handle that refers to nothing, like a null pointer
+         */
+        constexpr Handle() noexcept = default;
+
+        constexpr bool valid() const noexcept {
+            return index_ != NONE;
+        }
+
+        constexpr uint32_t index() const noexcept {
+            return index_;
+        }
+
+        friend constexpr bool operator==(const Handle&, const Handle&) noexcept = default;
+    };
+
+#ifdef NDEBUG
+    static_assert(sizeof(Handle<int>) == sizeof(uint32_t));
+#endif
+
+    /**
+     * @brief Memory pool. A large amount of memory is allocated up front, during construction (or held inline).
+     * Then, you can request chunks of memory from the pool, and this will be much faster as the memory has already been allocated.
+     *
+     * Free blocks are linked into a list through their own storage (an intrusive free list), so allocate() pops the
+     * head of the list and deallocate() pushes onto it - both O(1) however full the pool is, and no memory is spent
+     * on bookkeeping per block. Objects can be referred to by pointer or by 32 bit Handle, see handleOf() and get().
+     * Debug builds also keep a generation count per block, to catch double frees and stale handles.
+     * @note If N is left as utils::DYNAMIC_CAPACITY, storage for the pool is dynamically allocated at construction.
+     * Otherwise, storage is held inline, so the pool can live inside the object that owns it and never touches the heap.
+     * @tparam T Type of object held in pool
+     * @tparam N Capacity, fixed at compile time, or utils::DYNAMIC_CAPACITY to give it to the constructor
+     * @tparam Memory Where dynamically allocated storage comes from, see utils/memory.hpp
+     * @tparam CACHE_ALIGNED Give each element its own cache line(s), so objects used by different threads, or written
+     * next to ones that are only read, never share a line
+     */
+    template<typename T, size_t N = DYNAMIC_CAPACITY, typename Memory = HeapMemory, bool CACHE_ALIGNED = false>
     class MemPool final {
 
     private:
+        static constexpr bool IS_STATIC { N != DYNAMIC_CAPACITY };
+        static constexpr uint32_t NO_BLOCK { UINT32_MAX };
+        static constexpr size_t BLOCK_ALIGNMENT { std::max({ alignof(T), alignof(uint32_t), CACHE_ALIGNED ? CACHE_LINE_SIZE : 1 }) };
+
         struct Block {
-            T data;
-            bool is_free { true };
+            // Holds a T while allocated, or the index of the next free block while free
+            alignas(BLOCK_ALIGNMENT) std::byte storage_[std::max(sizeof(T), sizeof(uint32_t))];
         };
 
-        std::vector<Block> data_;
-        size_t next_free_index_ { 0 };
+        // These are required to ensure safety of an efficiency trick used when deallocating - see MemPool::deallocate().
+        static_assert(std::is_standard_layout_v<Block> && offsetof(Block, storage_) == 0, "Alignment error; T is not first member of struct.");
+        static_assert(sizeof(Block) % alignof(T) == 0, "Alignment error; consecutive blocks don't keep T aligned.");
+        static_assert(!CACHE_ALIGNED || sizeof(Block) % CACHE_LINE_SIZE == 0, "Alignment error; blocks don't fill whole cache lines.");
+        static_assert(N < NO_BLOCK, "MemPool size must fit in a 32 bit index.");
+
+        // One flag per block
+        using BlockSet = std::conditional_t<IS_STATIC, std::bitset<N>, std::vector<bool>>;
+
+        std::conditional_t<IS_STATIC, std::array<Block, N>, std::vector<Block, MemoryAllocator<Block, Memory>>> data_;
+        uint32_t free_head_ { NO_BLOCK };
+
+#ifndef NDEBUG
+        // Bumped every time a block is allocated or freed, so odd while it holds a live object
+        std::conditional_t<IS_STATIC, std::array<uint32_t, N>, std::vector<uint32_t>> generations_ { makeGenerations() };
+#endif
 
     public:
         /**
-         * @brief Create a new memory pool. Pool is initialized with all elements default constructed and marked as free.
-         * @param size Number of elements (of type T) in pool. 
-         * @note T must have a default constructor
+         * @brief Create a new memory pool. Memory for every element is allocated up front, but no objects are constructed.
+         * @param size Number of elements (of type T) in pool.
+         */
+        explicit MemPool(int size) requires (!IS_STATIC)
+            : data_(size)
+        {
+            ASSERT(data_.size() < NO_BLOCK, "MemPool size must fit in a 32 bit index.");
+            relink(makeSet(true));
+        }
+
+        /**
+         * @brief Create a new memory pool of N elements, held inline. No objects are constructed.
          */
-        explicit MemPool(int size)
-            : data_(size, { T(), true }) 
+        MemPool() requires IS_STATIC
         {
-            // This assert is required to ensure safety of an efficiency trick used when deallocating - see MemPool::deallocate().
-            ASSERT(reinterpret_cast<const Block*>(&(data_[0].data)) == &(data_[0]), "Alignment error; T is not first member of struct.");
+            relink(makeSet(true));
+        }
+
+        /**
+         * @brief Destroys any objects still allocated.
+         */
+        ~MemPool() {
+            destroyAllocated(0);
         }
-        
-        // Delete default ctor, copy ctor/assignment, move ctor/assigment as they don't make sense for a memory pool.
-        MemPool() = delete;
 
+        // Delete copy ctor/assignment, move ctor/assigment as they don't make sense for a memory pool.
         MemPool(const MemPool&) = delete;
         MemPool& operator=(const MemPool&) = delete;
 
@@ -58,76 +151,199 @@ namespace utils {
 
         /**
          * @brief Resize pool to a new size.
-         * @note If resizing to a smaller size, elements that don't fit will be destroyed
+         * @note If resizing to a smaller size, elements that don't fit will be destroyed. Growing may move the pool,
+         * invalidating pointers to allocated elements.
          * @param new_size New size of pool. Can be larger or smaller than current size.
          */
-        void resize(size_t new_size) {
-            data_.resize(new_size, { T(), true });
-            next_free_index_ = 0;
-            updateFreeIndex();
+        void resize(size_t new_size) requires (!IS_STATIC) {
+            ASSERT(new_size < NO_BLOCK, "MemPool size must fit in a 32 bit index.");
+            auto free { freeBlocks() };
+            destroyAllocated(new_size, free);
+
+            if constexpr (!std::is_trivially_copyable_v<T>) {
+                if (new_size > data_.capacity()) {
+                    // Blocks are raw bytes, so letting the vector reallocate would copy live objects bytewise
+                    decltype(data_) moved(new_size);
+                    for (size_t index { 0 }; index < data_.size(); ++index) {
+                        if (!free[index]) {
+                            auto& elem { *std::launder(reinterpret_cast<T*>(data_[index].storage_)) };
+                            ::new (moved[index].storage_) T(std::move(elem));
+                            elem.~T();
+                        }
+                    }
+                    data_.swap(moved);
+                }
+            }
+            data_.resize(new_size);
+            free.resize(new_size, true);
+#ifndef NDEBUG
+            generations_.resize(new_size, 0);
+#endif
+            relink(free);
         }
 
 
         /**
          * @brief Allocate a new object in the next free block of the memory pool.
-         * 
+         *
          * @tparam Args types of arguments
          * @param args arguments forwarded to ctor of object being allocated
          * @return Pointer to new object
          */
         template<typename... Args>
-        T* allocate(Args... args) noexcept {
-            Block* ptr { &(data_[next_free_index_]) };
-            ASSERT(ptr->is_free, "Memory pool out of space.");
-        
-            T* obj { &(ptr->data) };
-
-            // Construct new T, forwarding arguments, directly inside obj
-            new(obj) T(std::forward<Args>(args)...);
-            ptr->is_free = false;
+        T* allocate(Args&&... args) noexcept {
+            const auto index { free_head_ };
+            if (index == NO_BLOCK) [[unlikely]] {
+                FATAL("Memory pool out of space.");
+            }
+            free_head_ = nextFree(index);
+#ifndef NDEBUG
+            ++generations_[index];
+#endif
 
-            updateFreeIndex();
-            return obj;
+            // Construct new T, forwarding arguments, directly inside the block
+            return ::new (data_[index].storage_) T(std::forward<Args>(args)...);
         }
 
         /**
          * @brief Deallocate the element inside the pool given by the ptr elem.
-         * Checks that pointer points to a valid element inside the pool. If it points to something not in the pool, or to something that's already been deallocated,
-         * an assertion error will occur.
+         * Checks that pointer points to a valid element inside the pool. If it points to something not in the pool an assertion error will occur,
+         * as will deallocating something that's already been deallocated in debug builds.
          * @param elem Pointer to the element to be deallocated
          */
         void deallocate(const T* elem) noexcept {
-            auto index { reinterpret_cast<const Block*>(elem) - &data_[0] };
-            
-            // If the given pointer doesn't point to an element within the pool, this index will be out of bounds
-            ASSERT(index >= 0 && index < data_.size(), "Pointer provided doesn't point to something in this pool.");
-            
-            ASSERT(!data_[index].is_free, "Attempted to deallocate unallocated entry in pool.");
-            data_[index].is_free = true;
-            data_[index].data.~T();
-            next_free_index_ = index;
+            const auto index { indexOf(elem) };
+#ifndef NDEBUG
+            ASSERT(generations_[index] & 1, "Attempted to deallocate unallocated entry in pool.");
+            ++generations_[index];
+#endif
+            std::launder(const_cast<T*>(elem))->~T();
+            setNextFree(index, free_head_);
+            free_head_ = index;
         };
 
+        /**
+         * @brief Deallocate the element the handle refers to.
+         */
+        void deallocate(Handle<T> handle) noexcept {
+            deallocate(get(handle));
+        }
+
+        /**
+         * @brief Get a handle to an allocated element, to store in place of the pointer.
+         * @param elem Pointer to an element allocated from this pool
+         */
+        Handle<T> handleOf(const T* elem) const noexcept {
+            Handle<T> handle;
+            handle.index_ = indexOf(elem);
+#ifndef NDEBUG
+            handle.generation_ = generations_[handle.index_];
+            ASSERT(handle.generation_ & 1, "Handle requested for unallocated entry in pool.");
+#endif
+            return handle;
+        }
+
+        /**
+         * @brief Get the element a handle refers to.
+         * @note The handle must be valid(). Debug builds check the element hasn't been deallocated since.
+         */
+        T* get(Handle<T> handle) noexcept {
+            return const_cast<T*>(std::as_const(*this).get(handle));
+        }
+
+        const T* get(Handle<T> handle) const noexcept {
+#ifndef NDEBUG
+            ASSERT(handle.index_ < capacity() && generations_[handle.index_] == handle.generation_, "Handle refers to an element that has been deallocated.");
+#endif
+            return std::launder(reinterpret_cast<const T*>(data_[handle.index_].storage_));
+        }
+
+        constexpr size_t capacity() const noexcept {
+            if constexpr (IS_STATIC) {
+                return N;
+            } else {
+                return data_.size();
+            }
+        }
+
     private:
+        uint32_t indexOf(const T* elem) const noexcept {
+            // T is at the start of its block, so the pointer is also a pointer to the block
+            const auto index { reinterpret_cast<const Block*>(elem) - data_.data() };
+
+            // If the given pointer doesn't point to an element within the pool, this index will be out of bounds
+            if (index < 0 || static_cast<size_t>(index) >= capacity()) [[unlikely]] {
+                FATAL("Pointer provided doesn't point to something in this pool.");
+            }
+            return static_cast<uint32_t>(index);
+        }
+
+#ifndef NDEBUG
+        auto makeGenerations() const {
+            if constexpr (IS_STATIC) {
+                return std::array<uint32_t, N> {};
+            } else {
+                return std::vector<uint32_t>(data_.size(), 0);
+            }
+        }
+#endif
+
+        BlockSet makeSet(bool value) const {
+            if constexpr (IS_STATIC) {
+                return value ? BlockSet {}.set() : BlockSet {};
+            } else {
+                return BlockSet(data_.size(), value);
+            }
+        }
+
+        uint32_t nextFree(size_t index) const noexcept {
+            return *std::launder(reinterpret_cast<const uint32_t*>(data_[index].storage_));
+        }
+
+        void setNextFree(size_t index, uint32_t next) noexcept {
+            ::new (data_[index].storage_) uint32_t { next };
+        }
+
+        /**
+         * @brief Walk the free list to find which blocks are free. For operations off the hot path only.
+         */
+        BlockSet freeBlocks() const {
+            auto free { makeSet(false) };
+            for (auto index { free_head_ }; index != NO_BLOCK; index = nextFree(index)) {
+                free[index] = true;
+            }
+            return free;
+        }
+
         /**
-         * @brief Internal helper method called when pool changes to find
-         * and set the next free index.
-         * The idea is to start from the initial index and walk forward, trying to find a free block, since that's where we are most likely to find a free block.
-         * If we don't find one, we start from 0 (maybe something was deallocated) and walk up to initial_free_index.
-         * If we still don't find one, the memory pool is full and we log a fatal error.
-         * @todo find more efficient implementation
+         * @brief Rebuild the free list from the given free blocks, lowest index first
          */
-        void updateFreeIndex() noexcept {
-            const auto initial_free_index = next_free_index_;
-            const size_t total_size = data_.size();
+        void relink(const BlockSet& free) noexcept {
+            free_head_ = NO_BLOCK;
+            for (auto index { data_.size() }; index-- > 0;) {
+                if (free[index]) {
+                    setNextFree(index, free_head_);
+                    free_head_ = static_cast<uint32_t>(index);
+                }
+            }
+        }
 
-            for (size_t count = 0; count < total_size; ++count) {
-                if (data_[next_free_index_].is_free) {
-                    return; // found a free index, early exit
+        /**
+         * @brief Destroy the objects still allocated in blocks from index first onwards
+         */
+        void destroyAllocated(size_t first, const BlockSet& free) noexcept {
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                for (auto index { first }; index < data_.size(); ++index) {
+                    if (!free[index]) {
+                        std::launder(reinterpret_cast<T*>(data_[index].storage_))->~T();
+                    }
                 }
+            }
+        }
 
-                // Use modulo to wrap around to the beginning when we reach the end
-                next_free_index_ = (next_free_index_ + 1) % total_size;
+        void destroyAllocated(size_t first) {
+            if constexpr (!std::is_trivially_destructible_v<T>) {
+                destroyAllocated(first, freeBlocks());
             }
         }
 
@@ -0,0 +1,200 @@
+#pragma once
+/**
+ * @file slab_allocator.hpp
+ * @brief Allocator for objects of many sizes, from per size class free lists carved out of huge page arenas
+ * @version 0.1
+ * @test tests/utils/slab_allocator_test.cpp
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+#include "utils/assertions.hpp"
+#include "utils/constants.hpp"
+#include "utils/memory.hpp"
+
+namespace utils {
+
+    /**
+     * @brief Block sizes a SlabAllocator rounds allocations up to, smallest first. Each must be a multiple of
+     * alignof(std::max_align_t), so every block is suitably aligned for any type.
+     * Tune them to the sizes actually allocated to waste less memory, or use PowerOfTwoSizeClasses.
+     */
+    template<size_t... SIZES>
+    struct SizeClasses {
+        static constexpr std::array<size_t, sizeof...(SIZES)> SIZES_ { SIZES... };
+    };
+
+    template<size_t MIN, size_t... SHIFTS>
+    SizeClasses<(MIN << SHIFTS)...> powerOfTwoSizeClasses(std::index_sequence<SHIFTS...>);
+
+    /**
+     * @brief Size classes MIN, 2 * MIN, 4 * MIN ... up to MAX
+     */
+    template<size_t MIN, size_t MAX>
+    using PowerOfTwoSizeClasses = decltype(powerOfTwoSizeClasses<MIN>(std::make_index_sequence<std::bit_width(MAX / MIN)>()));
+
+    /**
+     * @brief Allocator for objects whose sizes vary - messages, strings, sockets, per session state - so that, like
+     * MemPool does for one type, nothing on a hot thread has to go to malloc.
+     *
+     * Each allocation is rounded up to a size class, picked with a single table lookup. Each class has its own
+     * intrusive free list: allocating pops it and deallocating pushes onto it, both O(1). When a class's list is empty,
+     * a new block is carved off the current arena - a large region, from huge pages by default, allocated up front.
+     * Only when the arena runs out is another one allocated.
+     *
+     * No locks: an allocator must only be used from one thread. Give each thread that needs one its own.
+     * Deallocation needs the size that was allocated (as with sized delete), so blocks carry no headers.
+     * @tparam Classes Size classes, see SizeClasses
+     * @tparam Memory Where arenas come from, see utils/memory.hpp
+     */
+    template<typename Classes = PowerOfTwoSizeClasses<16, 4096>, typename Memory = HugePageMemory<>>
+    class SlabAllocator final {
+    private:
+        static constexpr auto CLASS_SIZES { Classes::SIZES_ };
+        static constexpr size_t CLASSES { CLASS_SIZES.size() };
+        static constexpr size_t GRANULE { alignof(std::max_align_t) };
+
+        static_assert(CLASSES > 0 && CLASSES <= UINT8_MAX, "SlabAllocator needs between 1 and 255 size classes");
+        static_assert(std::is_sorted(CLASS_SIZES.begin(), CLASS_SIZES.end()), "SlabAllocator size classes must be in ascending order");
+        static_assert(std::all_of(CLASS_SIZES.begin(), CLASS_SIZES.end(), [](size_t size) { return size && size % GRANULE == 0; }),
+            "SlabAllocator size classes must be multiples of alignof(std::max_align_t)");
+
+    public:
+        // Largest allocation the size classes can hold
+        static constexpr size_t MAX_SIZE { CLASS_SIZES.back() };
+
+    private:
+        // Size class for every allocation size, in steps of GRANULE bytes
+        static constexpr auto CLASS_OF { []() {
+            std::array<uint8_t, MAX_SIZE / GRANULE + 1> class_of {};
+            uint8_t size_class { 0 };
+            for (size_t granules { 0 }; granules < class_of.size(); ++granules) {
+                while (CLASS_SIZES[size_class] < granules * GRANULE) {
+                    ++size_class;
+                }
+                class_of[granules] = size_class;
+            }
+            return class_of;
+        }() };
+
+        struct FreeBlock {
+            FreeBlock* next_;
+        };
+
+        std::array<FreeBlock*, CLASSES> free_ {};
+
+        // Unused part of the current arena
+        std::byte* cursor_ { nullptr };
+        std::byte* end_ { nullptr };
+
+        const size_t arena_size_;
+        std::vector<std::byte*> arenas_;
+
+    public:
+        /**
+         * @brief Create a new allocator, allocating its first arena up front.
+         * @param arena_size Bytes in each arena. Rounded up to a whole number of huge pages by HugePageMemory anyway,
+         * so it's best kept a multiple of HUGE_PAGE_SIZE.
+         */
+        explicit SlabAllocator(size_t arena_size = HUGE_PAGE_SIZE)
+            : arena_size_ { arena_size }
+        {
+            ASSERT(arena_size >= MAX_SIZE, "SlabAllocator arenas must hold at least one block of the largest size class.");
+            addArena();
+        }
+
+        /**
+         * @brief Frees every arena. Objects still allocated are not destroyed.
+         */
+        ~SlabAllocator() {
+            for (auto arena : arenas_) {
+                Memory::deallocate(arena, arena_size_);
+            }
+        }
+
+        // Delete copy, move ctors and assignment operators
+        SlabAllocator(const SlabAllocator&) = delete;
+        SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+        SlabAllocator(SlabAllocator&&) = delete;
+        SlabAllocator& operator=(SlabAllocator&&) = delete;
+
+        /**
+         * @brief Allocate at least bytes of memory, aligned to alignof(std::max_align_t).
+         * @param bytes Size wanted, at most MAX_SIZE
+         */
+        void* allocate(size_t bytes) noexcept {
+            if (bytes > MAX_SIZE) [[unlikely]] {
+                FATAL("Allocation too large for slab allocator size classes.");
+            }
+            const auto size_class { CLASS_OF[(bytes + GRANULE - 1) / GRANULE] };
+            if (auto block { free_[size_class] }) {
+                free_[size_class] = block->next_;
+                return block;
+            }
+            return carve(CLASS_SIZES[size_class]);
+        }
+
+        /**
+         * @brief Return memory from allocate() to its size class' free list.
+         * @param ptr Memory to free
+         * @param bytes Size it was allocated with
+         */
+        void deallocate(void* ptr, size_t bytes) noexcept {
+            const auto size_class { CLASS_OF[(bytes + GRANULE - 1) / GRANULE] };
+            free_[size_class] = ::new (ptr) FreeBlock { free_[size_class] };
+        }
+
+        /**
+         * @brief Allocate and construct a T. sizeof(T) is known at compile time, so the size class lookup folds away.
+         * @param args arguments forwarded to ctor of object being allocated
+         * @return Pointer to new object
+         */
+        template<typename T, typename... Args>
+        T* create(Args&&... args) {
+            static_assert(sizeof(T) <= MAX_SIZE, "Type too large for slab allocator size classes");
+            static_assert(alignof(T) <= GRANULE, "Type is over aligned for slab allocator blocks");
+            return ::new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Destroy a T from create() and free its memory.
+         */
+        template<typename T>
+        void destroy(T* obj) noexcept {
+            obj->~T();
+            deallocate(obj, sizeof(T));
+        }
+
+        /**
+         * @brief Number of arenas allocated so far
+         */
+        size_t arenas() const noexcept {
+            return arenas_.size();
+        }
+
+    private:
+        void* carve(size_t size) {
+            if (static_cast<size_t>(end_ - cursor_) < size) [[unlikely]] {
+                addArena();
+            }
+            return std::exchange(cursor_, cursor_ + size);
+        }
+
+        void addArena() {
+            const auto arena { static_cast<std::byte*>(Memory::allocate(arena_size_)) };
+            arenas_.push_back(arena);
+            cursor_ = arena;
+            end_ = arena + arena_size_;
+        }
+    };
+}
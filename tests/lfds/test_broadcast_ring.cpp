@@ -0,0 +1,189 @@
+#include "lfds/broadcast_ring.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace lfds;
+
+namespace {
+    void publish(auto& ring, size_t value) {
+        auto slot { ring.getNextWriteTo() };
+        ASSERT_NE(slot, nullptr);
+        *slot = value;
+        ring.updateWriteIndex();
+    }
+}
+
+// Every consumer sees every message, in order
+TEST(BroadcastRingTests, EveryConsumerSeesEveryMessage) {
+    BroadcastRing<size_t> ring { 8 };
+    auto& first { ring.addConsumer() };
+    auto& second { ring.addConsumer() };
+
+    for (size_t i = 0; i < 5; ++i) {
+        publish(ring, i);
+    }
+
+    for (auto consumer : { &first, &second }) {
+        for (size_t i = 0; i < 5; ++i) {
+            auto value { consumer->getNextRead() };
+            ASSERT_NE(value, nullptr);
+            ASSERT_EQ(*value, i);
+            consumer->updateReadIndex();
+        }
+        ASSERT_EQ(consumer->getNextRead(), nullptr);
+    }
+}
+
+// Producer can't lap the slowest consumer in GATE mode
+TEST(BroadcastRingTests, ProducerGatedOnSlowestConsumer) {
+    BroadcastRing<size_t, 4> ring;
+    auto& fast { ring.addConsumer() };
+    auto& slow { ring.addConsumer() };
+
+    for (size_t i = 0; i < 4; ++i) {
+        publish(ring, i);
+    }
+    ASSERT_EQ(fast.peekBatch().size(), 4);
+    fast.releaseBatch(4);
+    ASSERT_EQ(ring.getNextWriteTo(), nullptr);
+
+    slow.updateReadIndex();
+    publish(ring, 4);
+    ASSERT_EQ(ring.getNextWriteTo(), nullptr);
+}
+
+// Dependent consumer only sees messages its dependency has finished with, and sees what it wrote to them
+TEST(BroadcastRingTests, DependencyChain) {
+    BroadcastRing<size_t, 8> ring;
+    auto& enricher { ring.addConsumer() };
+    auto& downstream { ring.addConsumer({ &enricher }) };
+
+    publish(ring, 1);
+    publish(ring, 2);
+    ASSERT_EQ(downstream.getNextRead(), nullptr);
+
+    auto value { enricher.getNextRead() };
+    *value *= 100;
+    enricher.updateReadIndex();
+
+    ASSERT_EQ(*downstream.getNextRead(), 100);
+    downstream.updateReadIndex();
+    ASSERT_EQ(downstream.getNextRead(), nullptr);
+    ASSERT_EQ(downstream.position(), 1);
+
+    // Only downstream gates the producer, and it's at 1, so the producer can get up to 9
+    for (size_t i = 2; i < 9; ++i) {
+        publish(ring, i);
+    }
+    ASSERT_EQ(ring.getNextWriteTo(), nullptr);
+}
+
+TEST(BroadcastRingTests, ReleaseMoreThanReadDies) {
+    BroadcastRing<size_t, 4> ring;
+    auto& consumer { ring.addConsumer() };
+    publish(ring, 1);
+    ASSERT_EQ(consumer.peekBatch().size(), 1);
+    ASSERT_DEATH(consumer.releaseBatch(2), "Attempted to release more messages than were read!");
+}
+
+// A consumer that falls a lap behind skips to the oldest message left, and counts what it missed
+TEST(BroadcastRingTests, OverwriteLapDetection) {
+    BroadcastRing<size_t, 4, BroadcastOverflow::OVERWRITE> ring;
+    auto& consumer { ring.addConsumer() };
+
+    for (size_t i = 0; i < 10; ++i) {
+        publish(ring, i);
+    }
+
+    // Slot holding 6 is the one the producer writes next, so only 7, 8, 9 are safe
+    size_t value;
+    ASSERT_TRUE(consumer.tryRead(value));
+    ASSERT_EQ(value, 7);
+    ASSERT_EQ(consumer.lost(), 7);
+    ASSERT_TRUE(consumer.tryRead(value));
+    ASSERT_TRUE(consumer.tryRead(value));
+    ASSERT_EQ(value, 9);
+    ASSERT_FALSE(consumer.tryRead(value));
+    ASSERT_EQ(consumer.lost(), 7);
+}
+
+/**
+ * @brief One producer, three consumers on their own threads (two independent, one depending on the first),
+ * all checking they get every message in order.
+ */
+TEST(BroadcastRingTests, MultithreadedBroadcast) {
+    constexpr size_t COUNT { 100'000 };
+    BroadcastRing<size_t, 1024> ring;
+    auto& a { ring.addConsumer() };
+    auto& b { ring.addConsumer() };
+    auto& c { ring.addConsumer({ &a }) };
+
+    std::vector<std::thread> consumers;
+    for (auto consumer : { &a, &b, &c }) {
+        consumers.emplace_back([consumer]() {
+            size_t expected { 0 };
+            while (expected < COUNT) {
+                auto batch { consumer->peekBatch() };
+                if (batch.empty()) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (auto value : batch) {
+                    ASSERT_EQ(value, expected++);
+                }
+                consumer->releaseBatch(batch.size());
+            }
+        });
+    }
+
+    for (size_t i = 0; i < COUNT; ++i) {
+        size_t* slot;
+        while (!(slot = ring.getNextWriteTo())) {
+            std::this_thread::yield();
+        }
+        *slot = i;
+        ring.updateWriteIndex();
+    }
+
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+    ASSERT_EQ(c.position(), COUNT);
+}
+
+/**
+ * @brief Consumer in OVERWRITE mode may miss messages, but never sees a torn or out of order one.
+ */
+TEST(BroadcastRingTests, MultithreadedOverwrite) {
+    constexpr size_t COUNT { 100'000 };
+    struct Pair { size_t first; size_t second; };
+    BroadcastRing<Pair, 64, BroadcastOverflow::OVERWRITE> ring;
+    auto& consumer { ring.addConsumer() };
+
+    std::thread reader([&]() {
+        size_t seen { 0 };
+        size_t last { 0 };
+        Pair pair;
+        while (last + 1 < COUNT) {
+            if (!consumer.tryRead(pair)) {
+                std::this_thread::yield();
+                continue;
+            }
+            ASSERT_EQ(pair.first, pair.second);
+            if (seen++) {
+                ASSERT_GT(pair.first, last);
+            }
+            last = pair.first;
+        }
+        ASSERT_EQ(seen + consumer.lost(), COUNT);
+    });
+
+    for (size_t i = 0; i < COUNT; ++i) {
+        auto slot { ring.getNextWriteTo() };
+        slot->first = i;
+        slot->second = i;
+        ring.updateWriteIndex();
+    }
+    reader.join();
+}
@@ -0,0 +1,129 @@
+#include "lfds/byte_ring.hpp"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+
+using namespace lfds;
+
+namespace {
+    std::string readString(ByteRecord* record) {
+        return { reinterpret_cast<const char*>(record->data()), record->size_ };
+    }
+}
+
+TEST(ByteRingTests, WriteThenRead) {
+    ByteRing<> ring { 256 };
+    ASSERT_EQ(ring.peek(), nullptr);
+
+    ASSERT_TRUE(ring.tryWrite("hello", 5, 1));
+    ASSERT_TRUE(ring.tryWrite("", 0, 2));
+    // Header plus payload rounded up to 8 bytes
+    ASSERT_EQ(ring.bytesUsed(), 16 + 8);
+
+    auto record { ring.peek() };
+    ASSERT_NE(record, nullptr);
+    ASSERT_EQ(record->type_, 1);
+    ASSERT_EQ(readString(record), "hello");
+    ring.consume();
+
+    record = ring.peek();
+    ASSERT_EQ(record->type_, 2);
+    ASSERT_EQ(record->size_, 0);
+    ring.consume();
+
+    ASSERT_EQ(ring.peek(), nullptr);
+    ASSERT_EQ(ring.bytesUsed(), 0);
+}
+
+TEST(ByteRingTests, ReserveAndShrink) {
+    ByteRing<128> ring;
+    auto data { ring.reserve(ring.maxRecordSize(), 7) };
+    ASSERT_NE(data, nullptr);
+    std::memcpy(data, "abc", 3);
+    ring.commit(3);
+    ASSERT_EQ(ring.bytesUsed(), 16);
+
+    auto record { ring.peek() };
+    ASSERT_EQ(readString(record), "abc");
+    ASSERT_EQ(record->type_, 7);
+}
+
+TEST(ByteRingTests, FullRing) {
+    ByteRing<64> ring;
+    // 24 bytes each
+    ASSERT_TRUE(ring.tryWrite("0123456789", 10));
+    ASSERT_TRUE(ring.tryWrite("0123456789", 10));
+    ASSERT_FALSE(ring.tryWrite("0123456789", 10));
+    ASSERT_TRUE(ring.tryWrite("01234567", 8));
+    ASSERT_EQ(ring.bytesUsed(), 64);
+    ASSERT_FALSE(ring.tryWrite("", 0));
+
+    ring.peek();
+    ring.consume();
+    ASSERT_TRUE(ring.tryWrite("", 0));
+}
+
+// A record that doesn't fit at the end of the ring goes at the front, behind a padding record the consumer never sees
+TEST(ByteRingTests, PaddingAtWraparound) {
+    ByteRing<64> ring;
+    ASSERT_TRUE(ring.tryWrite("first", 5, 1));   // 16 bytes
+    ASSERT_TRUE(ring.tryWrite("0123456789abcdef", 16, 2));   // 24 bytes
+    ring.peek();
+    ring.consume();
+    ring.peek();
+    ring.consume();
+
+    // 24 bytes left at the end of the ring, record needs 32
+    ASSERT_TRUE(ring.tryWrite("0123456789abcdefghijklm", 23, 3));
+    ASSERT_EQ(ring.bytesUsed(), 24 + 32);
+
+    auto record { ring.peek() };
+    ASSERT_EQ(record->type_, 3);
+    ASSERT_EQ(readString(record), "0123456789abcdefghijklm");
+    ASSERT_EQ(reinterpret_cast<void*>(record), reinterpret_cast<void*>(ring.peek()));
+    ring.consume();
+    ASSERT_EQ(ring.bytesUsed(), 0);
+}
+
+TEST(ByteRingTests, InvalidUseDies) {
+    ByteRing<64> ring;
+    ASSERT_DEATH(ring.reserve(ring.maxRecordSize() + 1), "Attempted to reserve an invalid ByteRing record!");
+    ASSERT_DEATH(ring.commit(), "Attempted to commit a ByteRing record that wasn't reserved!");
+    ASSERT_DEATH(ring.consume(), "Attempted to read from empty ring!");
+    ring.reserve(4);
+    ASSERT_DEATH(ring.commit(8), "Attempted to commit more than was reserved in ByteRing!");
+}
+
+/**
+ * @brief Producer writing records of varying length, consumer checking each one arrives intact and in order.
+ */
+TEST(ByteRingTests, MultithreadedVariableLength) {
+    constexpr size_t COUNT { 100'000 };
+    ByteRing<> ring { 4096 };
+
+    std::thread consumer([&]() {
+        for (size_t i = 0; i < COUNT; ++i) {
+            ByteRecord* record;
+            while (!(record = ring.peek())) {
+                std::this_thread::yield();
+            }
+            ASSERT_EQ(record->type_, i % 1000);
+            ASSERT_EQ(record->size_, i % 200);
+            for (auto byte : record->payload()) {
+                ASSERT_EQ(byte, static_cast<std::byte>(i));
+            }
+            ring.consume();
+        }
+    });
+
+    for (size_t i = 0; i < COUNT; ++i) {
+        std::byte* data;
+        while (!(data = ring.reserve(i % 200, i % 1000))) {
+            std::this_thread::yield();
+        }
+        std::memset(data, static_cast<int>(i & 0xff), i % 200);
+        ring.commit();
+    }
+    consumer.join();
+    ASSERT_EQ(ring.bytesUsed(), 0);
+}
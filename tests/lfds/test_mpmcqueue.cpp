@@ -0,0 +1,195 @@
+#include "lfds/mpmcqueue.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace lfds;
+
+// Simple creation, push/pop
+TEST(MPMCQueueTests, CreateMPMCQueue) {
+    MPMCQueue<std::string> queue { 4 };
+    ASSERT_EQ(queue.capacity(), 4);
+
+    std::string out;
+    ASSERT_FALSE(queue.tryPop(out));
+
+    ASSERT_TRUE(queue.tryPush("abc"));
+    queue.push("def");
+    ASSERT_EQ(queue.size(), 2);
+
+    ASSERT_TRUE(queue.tryPop(out));
+    ASSERT_EQ(out, "abc");
+    queue.pop(out);
+    ASSERT_EQ(out, "def");
+    ASSERT_EQ(queue.size(), 0);
+}
+
+TEST(MPMCQueueTests, FullQueueRejectsTryPush) {
+    MPMCQueue<int, 2> queue;
+    ASSERT_TRUE(queue.tryPush(1));
+    ASSERT_TRUE(queue.tryPush(2));
+    ASSERT_FALSE(queue.tryPush(3));
+
+    int out;
+    ASSERT_TRUE(queue.tryPop(out));
+    ASSERT_EQ(out, 1);
+    ASSERT_TRUE(queue.tryPush(3));
+    ASSERT_TRUE(queue.tryPop(out));
+    ASSERT_EQ(out, 2);
+    ASSERT_TRUE(queue.tryPop(out));
+    ASSERT_EQ(out, 3);
+}
+
+// Move only types are moved in and out, and anything left in the queue is destroyed with it
+TEST(MPMCQueueTests, MoveOnlyElementsAndDestruction) {
+    auto tracked { std::make_shared<int>(5) };
+    {
+        MPMCQueue<std::shared_ptr<int>> queue { 4 };
+        queue.emplace(tracked);
+        queue.emplace(tracked);
+        ASSERT_EQ(tracked.use_count(), 3);
+
+        std::shared_ptr<int> out;
+        queue.pop(out);
+        ASSERT_EQ(*out, 5);
+    }
+    ASSERT_EQ(tracked.use_count(), 1);
+
+    MPMCQueue<std::unique_ptr<int>> queue { 2 };
+    ASSERT_TRUE(queue.tryEmplace(std::make_unique<int>(7)));
+    std::unique_ptr<int> out;
+    ASSERT_TRUE(queue.tryPop(out));
+    ASSERT_EQ(*out, 7);
+}
+
+// Batch pop takes the run of ready elements, stopping at max_count
+TEST(MPMCQueueTests, BatchPop) {
+    MPMCQueue<int, 8> queue;
+    int out[8];
+    ASSERT_EQ(queue.tryPopBatch(out, 8), 0);
+
+    for (int i = 0; i < 6; ++i) {
+        queue.push(i);
+    }
+    ASSERT_EQ(queue.tryPopBatch(out, 4), 4);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(out[i], i);
+    }
+
+    // Wraps around the end of the ring
+    for (int i = 6; i < 10; ++i) {
+        queue.push(i);
+    }
+    ASSERT_EQ(queue.popBatch(out, 8), 6);
+    for (int i = 0; i < 6; ++i) {
+        ASSERT_EQ(out[i], i + 4);
+    }
+}
+
+/**
+ * @brief Run num_producers threads pushing and num_consumers threads popping at once, and check every element
+ * comes out exactly once.
+ */
+void stressTest(int num_producers, int num_consumers, bool batch) {
+    constexpr int ITEMS_PER_PRODUCER { 10'000 };
+    const int total { num_producers * ITEMS_PER_PRODUCER };
+
+    MPMCQueue<int> queue { 32 };
+    std::vector<std::atomic<int>> seen(total);
+    std::atomic<int> consumed { 0 };
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < num_producers; ++p) {
+        threads.emplace_back([&queue, p]() {
+            for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+                // Alternate between the blocking and non-blocking versions
+                const int value { p * ITEMS_PER_PRODUCER + i };
+                if (i % 2) {
+                    queue.push(value);
+                } else {
+                    while (!queue.tryPush(value)) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        });
+    }
+    for (int c = 0; c < num_consumers; ++c) {
+        threads.emplace_back([&queue, &seen, &consumed, total, batch]() {
+            int out[8];
+            while (consumed.load() < total) {
+                const size_t count { batch ? queue.tryPopBatch(out, 8) : queue.tryPop(out[0]) };
+                for (size_t i { 0 }; i < count; ++i) {
+                    seen[out[i]].fetch_add(1);
+                }
+                consumed.fetch_add(count);
+                if (!count) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    ASSERT_EQ(consumed.load(), total);
+    for (int i = 0; i < total; ++i) {
+        ASSERT_EQ(seen[i].load(), 1) << "element " << i;
+    }
+    ASSERT_EQ(queue.size(), 0);
+}
+
+TEST(MPMCQueueTests, StressOneProducerOneConsumer) {
+    stressTest(1, 1, false);
+}
+
+TEST(MPMCQueueTests, StressOneProducerManyConsumers) {
+    stressTest(1, 4, false);
+}
+
+TEST(MPMCQueueTests, StressManyProducersOneConsumer) {
+    stressTest(4, 1, false);
+}
+
+TEST(MPMCQueueTests, StressManyProducersManyConsumers) {
+    stressTest(4, 4, false);
+}
+
+TEST(MPMCQueueTests, StressManyProducersManyBatchConsumers) {
+    stressTest(4, 4, true);
+}
+
+// Blocking pops wait for producers that haven't arrived yet
+TEST(MPMCQueueTests, BlockingPopWaitsForProducers) {
+    constexpr int NUM_THREADS { 4 };
+    constexpr int ITEMS_PER_THREAD { 5'000 };
+    MPMCQueue<int, 16> queue;
+    std::atomic<long long> sum { 0 };
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&queue, &sum]() {
+            for (int i = 0; i < ITEMS_PER_THREAD; ++i) {
+                int out;
+                queue.pop(out);
+                sum.fetch_add(out);
+            }
+        });
+    }
+    for (int t = 0; t < NUM_THREADS; ++t) {
+        threads.emplace_back([&queue]() {
+            for (int i = 1; i <= ITEMS_PER_THREAD; ++i) {
+                queue.push(i);
+            }
+        });
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(sum.load(), NUM_THREADS * (ITEMS_PER_THREAD * (ITEMS_PER_THREAD + 1LL) / 2));
+}
@@ -0,0 +1,109 @@
+#include "lfds/mpscqueue.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using namespace lfds;
+
+// Simple creation, write/read
+TEST(MPSCQueueTests, CreateMPSCQueue) {
+    MPSCQueue<std::string> queue { 4 };
+    ASSERT_EQ(queue.capacity(), 4);
+    ASSERT_EQ(queue.getNextRead(), nullptr);
+
+    auto write_ptr { queue.getNextWriteTo() };
+    *write_ptr = "abc";
+    queue.updateWriteIndex(write_ptr);
+    ASSERT_EQ(queue.size(), 1);
+
+    auto read_ptr { queue.getNextRead() };
+    ASSERT_NE(read_ptr, nullptr);
+    ASSERT_STREQ(read_ptr->c_str(), "abc");
+    queue.updateReadIndex();
+
+    ASSERT_EQ(queue.getNextRead(), nullptr);
+    ASSERT_EQ(queue.size(), 0);
+}
+
+// Claimed but unpublished slots are not visible to the consumer, and hold up everything claimed after them
+TEST(MPSCQueueTests, PublishOrderFollowsClaimOrder) {
+    MPSCQueue<int, 4> queue;
+
+    auto first { queue.getNextWriteTo() };
+    auto second { queue.getNextWriteTo() };
+    *second = 2;
+    queue.updateWriteIndex(second);
+    ASSERT_EQ(queue.getNextRead(), nullptr);
+
+    *first = 1;
+    queue.updateWriteIndex(first);
+
+    ASSERT_EQ(*queue.getNextRead(), 1);
+    queue.updateReadIndex();
+    ASSERT_EQ(*queue.getNextRead(), 2);
+    queue.updateReadIndex();
+}
+
+// Producers are refused once every slot holds an unread element
+TEST(MPSCQueueTests, FullQueueRejectsWrites) {
+    MPSCQueue<int> queue { 2 };
+    for (int i = 0; i < 2; ++i) {
+        auto write_ptr { queue.getNextWriteTo() };
+        ASSERT_NE(write_ptr, nullptr);
+        *write_ptr = i;
+        queue.updateWriteIndex(write_ptr);
+    }
+    ASSERT_EQ(queue.getNextWriteTo(), nullptr);
+
+    queue.updateReadIndex();
+    auto write_ptr { queue.getNextWriteTo() };
+    ASSERT_NE(write_ptr, nullptr);
+    *write_ptr = 2;
+    queue.updateWriteIndex(write_ptr);
+
+    ASSERT_EQ(*queue.getNextRead(), 1);
+    queue.updateReadIndex();
+    ASSERT_EQ(*queue.getNextRead(), 2);
+}
+
+TEST(MPSCQueueTests, ReadFromEmptyQueueFails) {
+    MPSCQueue<int> queue { 2 };
+    ASSERT_DEATH(queue.updateReadIndex(), "Attempted to read from empty queue!");
+}
+
+// Several producers at once. Every element arrives exactly once, and each producer's elements arrive in order.
+TEST(MPSCQueueTests, MultipleProducersSingleConsumer) {
+    constexpr int NUM_PRODUCERS { 4 };
+    constexpr int ITEMS_PER_PRODUCER { 20'000 };
+    MPSCQueue<std::pair<int, int>, 64> queue;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < NUM_PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p]() {
+            for (int i = 0; i < ITEMS_PER_PRODUCER; ++i) {
+                std::pair<int, int>* write_ptr { nullptr };
+                while (!(write_ptr = queue.getNextWriteTo())) {
+                    std::this_thread::yield();
+                }
+                *write_ptr = { p, i };
+                queue.updateWriteIndex(write_ptr);
+            }
+        });
+    }
+
+    std::vector<int> next_expected(NUM_PRODUCERS, 0);
+    for (int received = 0; received < NUM_PRODUCERS * ITEMS_PER_PRODUCER; ++received) {
+        std::pair<int, int>* read_ptr { nullptr };
+        while (!(read_ptr = queue.getNextRead())) {
+            std::this_thread::yield();
+        }
+        auto [producer, value] { *read_ptr };
+        ASSERT_EQ(value, next_expected[producer]++);
+        queue.updateReadIndex();
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    ASSERT_EQ(queue.size(), 0);
+}
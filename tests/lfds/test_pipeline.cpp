@@ -0,0 +1,128 @@
+#include "lfds/pipeline.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace lfds;
+
+namespace {
+    struct Update {
+        int sequence;
+        long price;
+    };
+
+    struct Signal {
+        int sequence;
+        bool buy;
+    };
+
+    // Wait strategy that gives up the core straight away, as tests can run on a single core
+    struct YieldWait {
+        template<typename Ready>
+        void wait(Ready&& ready) {
+            while (!ready()) {
+                std::this_thread::yield();
+            }
+        }
+    };
+}
+
+// Elements flow through every stage in order, filtered stages drop theirs, and counters add up
+TEST(PipelineTests, ChainDeliversInOrder) {
+    constexpr int COUNT { 100000 };
+    Pipeline<YieldWait, 16> pipeline { 256 };
+
+    int next { 0 };
+    std::vector<Signal> received;
+    std::atomic<size_t> received_count { 0 };
+
+    pipeline.source<int>("decode", -1, [&next](int& out) {
+            if (next == COUNT) {
+                return false;
+            }
+            out = next++;
+            return true;
+        })
+        .then<Update>("book", -1, [](const int& in, Update& out) {
+            out = { in, in * 10L };
+            return true;
+        })
+        .then<Signal>("signal", -1, [](const Update& in, Signal& out) {
+            if (in.sequence % 2) {
+                return false;
+            }
+            out = { in.sequence, in.price % 20 == 0 };
+            return true;
+        })
+        .sink("order", -1, [&received, &received_count](const Signal& in) {
+            received.push_back(in);
+            received_count.store(received.size(), std::memory_order_release);
+        });
+
+    pipeline.start();
+    while (received_count.load(std::memory_order_acquire) < COUNT / 2) {
+        std::this_thread::yield();
+    }
+    pipeline.stop();
+
+    ASSERT_EQ(received.size(), COUNT / 2);
+    for (int i = 0; i < COUNT / 2; ++i) {
+        ASSERT_EQ(received[i].sequence, 2 * i);
+        ASSERT_TRUE(received[i].buy);
+    }
+
+    auto stats { pipeline.stats() };
+    ASSERT_EQ(stats.size(), 4);
+    ASSERT_EQ(stats[0].name, "decode");
+    ASSERT_EQ(stats[0].emitted, COUNT);
+    ASSERT_EQ(stats[1].processed, COUNT);
+    ASSERT_EQ(stats[1].emitted, COUNT);
+    ASSERT_EQ(stats[2].processed, COUNT);
+    ASSERT_EQ(stats[2].emitted, COUNT / 2);
+    ASSERT_EQ(stats[3].processed, COUNT / 2);
+    for (const auto& stage : stats) {
+        ASSERT_GT(stage.batches, 0);
+        ASSERT_LE(stage.batches, stage.processed);
+        ASSERT_GE(stage.busy_ns, stage.max_batch_ns);
+    }
+    ASSERT_EQ(stats[0].input.residency_samples, 0);
+    ASSERT_GT(stats[3].input.residency_samples, 0);
+}
+
+// Stopping a running pipeline lets every element the source produced reach the sink
+TEST(PipelineTests, StopDrainsQueues) {
+    Pipeline<YieldWait> pipeline { 64 };
+    std::atomic<size_t> consumed { 0 };
+
+    size_t next { 0 };
+    pipeline.source<size_t>("source", -1, [&next](size_t& out) {
+            out = next++;
+            return true;
+        })
+        .sink("sink", -1, [&consumed](const size_t& in) {
+            ASSERT_EQ(in, consumed.load(std::memory_order_relaxed));
+            consumed.store(in + 1, std::memory_order_relaxed);
+        });
+
+    pipeline.start();
+    while (consumed.load(std::memory_order_relaxed) < 1000) {
+        std::this_thread::yield();
+    }
+    pipeline.stop();
+
+    auto stats { pipeline.stats() };
+    ASSERT_EQ(stats[0].emitted, next);
+    ASSERT_EQ(stats[1].processed, next);
+    ASSERT_EQ(consumed.load(), next);
+}
+
+TEST(PipelineTests, InvalidPipelinesDie) {
+    Pipeline<> no_sink;
+    no_sink.source<int>("source", -1, [](int&) { return false; });
+    ASSERT_DEATH(no_sink.start(), "Pipeline must end in a sink");
+
+    Pipeline<YieldWait> two_sources;
+    two_sources.source<int>("source", -1, [](int&) { return false; }).sink("sink", -1, [](const int&) {});
+    ASSERT_DEATH(two_sources.source<int>("source", -1, [](int&) { return false; }), "Pipeline can only have one source.");
+}
@@ -0,0 +1,99 @@
+#include "lfds/queue_telemetry.hpp"
+#include "lfds/spscqueue.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace lfds;
+
+// Instrumentation compiles away completely by default
+static_assert(sizeof(SPSCQueue<int, 16>) == sizeof(SPSCQueue<int, 16, QueueOverflow::FAIL_FAST, NoTelemetry>));
+
+TEST(QueueTelemetryTests, FullAndEmptyEvents) {
+    SPSCQueue<int, 4, QueueOverflow::FAIL_FAST, QueueTelemetry<1>> queue;
+    ASSERT_EQ(queue.getNextRead(), nullptr);
+    ASSERT_TRUE(queue.peekBatch().empty());
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(queue.push(i));
+    }
+    ASSERT_FALSE(queue.push(4));
+    ASSERT_TRUE(queue.reserveBatch(1).empty());
+
+    auto stats { queue.stats() };
+    ASSERT_EQ(stats.depth, 4);
+    ASSERT_EQ(stats.peak_depth, 4);
+    ASSERT_EQ(stats.full_events, 2);
+    ASSERT_EQ(stats.empty_events, 1);
+
+    // Polling an empty queue one element at a time isn't a drain
+    int out;
+    while (queue.tryPop(out)) {}
+    ASSERT_EQ(queue.getNextRead(), nullptr);
+    stats = queue.stats();
+    ASSERT_EQ(stats.depth, 0);
+    ASSERT_EQ(stats.peak_depth, 4);
+    ASSERT_EQ(stats.empty_events, 1);
+
+    ASSERT_TRUE(queue.peekBatch().empty());
+    ASSERT_EQ(queue.stats().empty_events, 2);
+}
+
+// Only every Nth element is timestamped and measured, across single and batch operations
+TEST(QueueTelemetryTests, ResidencySampling) {
+    SPSCQueue<int, 64, QueueOverflow::FAIL_FAST, QueueTelemetry<8>> queue;
+
+    for (int i = 0; i < 10; ++i) {
+        queue.push(i);
+    }
+    auto batch { queue.reserveBatch(20) };
+    queue.commitBatch(batch.size());
+    // Depth is measured when a publish includes a sampled element - here, after the whole batch
+    ASSERT_EQ(queue.stats().peak_depth, 30);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds { 1 });
+    queue.releaseBatch(queue.peekBatch(16).size());
+    int out;
+    while (queue.tryPop(out)) {}
+
+    // Elements 0, 8, 16, 24 were sampled
+    auto stats { queue.stats() };
+    ASSERT_EQ(stats.residency_samples, 4);
+    ASSERT_GE(stats.residency_max_ns, 1'000'000);
+    ASSERT_GE(stats.meanResidencyNanos(), 1'000'000);
+    ASSERT_GE(stats.residency_total_ns, 4 * 1'000'000);
+}
+
+// A monitor thread can read the counters while the queue is in use
+TEST(QueueTelemetryTests, MonitorWhileRunning) {
+    constexpr int NUM_ITEMS { 100'000 };
+    SPSCQueue<int, 64, QueueOverflow::SPIN_UNTIL_SPACE, QueueTelemetry<64>> queue;
+    std::atomic<bool> done { false };
+
+    std::thread monitor([&]() {
+        size_t last_samples { 0 };
+        while (!done) {
+            auto stats { queue.stats() };
+            ASSERT_LE(stats.peak_depth, queue.capacity());
+            ASSERT_GE(stats.residency_samples, last_samples);
+            last_samples = stats.residency_samples;
+            std::this_thread::yield();
+        }
+    });
+
+    std::thread producer([&]() {
+        for (int i = 0; i < NUM_ITEMS; ++i) {
+            queue.push(i);
+        }
+    });
+
+    int out;
+    for (int i = 0; i < NUM_ITEMS; ++i) {
+        queue.pop(out);
+        ASSERT_EQ(out, i);
+    }
+    producer.join();
+    done = true;
+    monitor.join();
+
+    ASSERT_EQ(queue.stats().residency_samples, NUM_ITEMS / 64 + 1);
+}
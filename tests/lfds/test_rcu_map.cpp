@@ -0,0 +1,121 @@
+#include "lfds/rcu_map.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lfds;
+
+namespace {
+    struct Instrument {
+        long tick_size;
+        long max_qty;
+    };
+}
+
+TEST(RcuMapTests, ReadersSeeUpdates) {
+    RcuMap<std::string, Instrument> map;
+    auto reader { map.registerReader() };
+    ASSERT_EQ(reader.find("ESZ3"), nullptr);
+
+    map.insertOrAssign("ESZ3", { 25, 100 });
+    auto instrument { reader.find("ESZ3") };
+    ASSERT_NE(instrument, nullptr);
+    ASSERT_EQ(instrument->tick_size, 25);
+
+    map.erase("ESZ3");
+    ASSERT_EQ(reader.find("ESZ3"), nullptr);
+}
+
+// A version a reader might still be using is only freed once the reader passes a quiescent point
+TEST(RcuMapTests, ReclaimWaitsForQuiescentReaders) {
+    RcuMap<int, long> map;
+    auto first { map.registerReader() };
+    auto second { map.registerReader() };
+
+    map.insertOrAssign(1, 10);
+    const auto& held { first.get() };
+    map.insertOrAssign(1, 20);
+    ASSERT_EQ(map.retired(), 2);
+    // Old version is untouched while held
+    ASSERT_EQ(held.at(1), 10);
+    ASSERT_EQ(first.get().at(1), 20);
+
+    first.quiescent();
+    map.reclaim();
+    ASSERT_EQ(map.retired(), 2);
+
+    second.quiescent();
+    map.reclaim();
+    ASSERT_EQ(map.retired(), 0);
+}
+
+// Offline and unregistered readers don't hold reclamation up
+TEST(RcuMapTests, OfflineReadersDontBlockReclaim) {
+    RcuMap<int, long> map;
+    auto online { map.registerReader() };
+    {
+        auto gone { map.registerReader() };
+    }
+    auto idle { map.registerReader() };
+    idle.offline();
+
+    map.insertOrAssign(1, 10);
+    ASSERT_EQ(map.retired(), 1);
+    online.quiescent();
+    map.synchronize();
+    ASSERT_EQ(map.retired(), 0);
+
+    idle.quiescent();
+    ASSERT_EQ(idle.find(1)[0], 10);
+}
+
+TEST(RcuMapTests, TooManyReadersDies) {
+    RcuMap<int, long, 2> map;
+    auto first { map.registerReader() };
+    auto second { map.registerReader() };
+    ASSERT_DEATH(map.registerReader(), "Too many RcuMap readers registered!");
+}
+
+// Readers always see a whole version, never a partial update, and versions only move forwards
+TEST(RcuMapTests, MultithreadedReadersAndWriter) {
+    constexpr long VERSIONS { 2000 };
+    RcuMap<int, long> map { { { 0, 0 }, { 1, 0 } } };
+    std::atomic<bool> done { false };
+
+    auto read { [&map, &done]() {
+        auto reader { map.registerReader() };
+        long last { 0 };
+        while (!done.load(std::memory_order_acquire)) {
+            const auto& version { reader.get() };
+            ASSERT_EQ(version.at(0), version.at(1));
+            ASSERT_GE(version.at(0), last);
+            last = version.at(0);
+            reader.quiescent();
+            std::this_thread::yield();
+        }
+    } };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back(read);
+    }
+
+    for (long i = 1; i <= VERSIONS; ++i) {
+        map.update([i](auto& version) {
+            version[0] = i;
+            version[1] = i;
+        });
+        if (i % 16 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    map.synchronize();
+    ASSERT_EQ(map.retired(), 0);
+    ASSERT_EQ(map.registerReader().get().at(0), VERSIONS);
+}
@@ -0,0 +1,168 @@
+#include "lfds/segmented_spscqueue.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace lfds;
+
+// Queue grows past its first segment instead of filling up, and elements come out in order
+TEST(SegmentedSPSCQueueTests, GrowsAcrossSegments) {
+    SegmentedSPSCQueue<std::string, 4> queue;
+    ASSERT_EQ(queue.getNextRead(), nullptr);
+    ASSERT_EQ(queue.segments(), 1);
+
+    for (int i = 0; i < 10; ++i) {
+        queue.push(std::to_string(i));
+    }
+    ASSERT_EQ(queue.size(), 10);
+    ASSERT_EQ(queue.segments(), 3);
+
+    std::string out;
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(queue.tryPop(out));
+        ASSERT_EQ(out, std::to_string(i));
+    }
+    ASSERT_FALSE(queue.tryPop(out));
+    ASSERT_EQ(queue.size(), 0);
+}
+
+// Once drained, segments are reused rather than allocating more
+TEST(SegmentedSPSCQueueTests, RecyclesDrainedSegments) {
+    SegmentedSPSCQueue<int, 4> queue { 2 };
+    ASSERT_EQ(queue.segments(), 2);
+
+    int out;
+    for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 6; ++i) {
+            queue.push(i);
+        }
+        for (int i = 0; i < 6; ++i) {
+            ASSERT_TRUE(queue.tryPop(out));
+            ASSERT_EQ(out, i);
+        }
+    }
+    ASSERT_EQ(queue.segments(), 3);
+}
+
+// Drained segments beyond max_spare_segments are freed
+TEST(SegmentedSPSCQueueTests, FreesSpareSegmentsOverLimit) {
+    SegmentedSPSCQueue<int, 4> queue { 1, 2 };
+    for (int i = 0; i < 40; ++i) {
+        queue.push(i);
+    }
+    ASSERT_EQ(queue.segments(), 11);
+
+    int out;
+    while (queue.tryPop(out)) {}
+    ASSERT_EQ(queue.segments(), 3);
+}
+
+// Batches stop at the end of a segment, and pick up in the next one
+TEST(SegmentedSPSCQueueTests, BatchesStopAtSegmentEnd) {
+    SegmentedSPSCQueue<int, 8> queue;
+
+    int next { 0 };
+    for (size_t remaining { 20 }; remaining;) {
+        auto batch { queue.reserveBatch(remaining) };
+        ASSERT_FALSE(batch.empty());
+        ASSERT_LE(batch.size(), 8);
+        for (auto& element : batch) {
+            element = next++;
+        }
+        queue.commitBatch(batch.size());
+        remaining -= batch.size();
+    }
+
+    auto batch { queue.peekBatch(5) };
+    ASSERT_EQ(batch.size(), 5);
+    queue.releaseBatch(5);
+    batch = queue.peekBatch();
+    ASSERT_EQ(batch.size(), 3);
+    ASSERT_EQ(batch[0], 5);
+    ASSERT_DEATH(queue.releaseBatch(4), "Attempted to release more elements than were read!");
+    queue.releaseBatch(3);
+
+    int expected { 8 };
+    for (batch = queue.peekBatch(); !batch.empty(); batch = queue.peekBatch()) {
+        for (auto value : batch) {
+            ASSERT_EQ(value, expected++);
+        }
+        queue.releaseBatch(batch.size());
+    }
+    ASSERT_EQ(expected, 20);
+}
+
+// Elements left in the queue are destroyed with it, including those in later segments
+TEST(SegmentedSPSCQueueTests, DestroysUnreadElements) {
+    auto tracker { std::make_shared<int>(0) };
+    {
+        SegmentedSPSCQueue<std::shared_ptr<int>, 4> queue;
+        for (int i = 0; i < 10; ++i) {
+            queue.push(tracker);
+        }
+        std::shared_ptr<int> out;
+        queue.tryPop(out);
+        queue.getNextWriteTo();
+        ASSERT_EQ(tracker.use_count(), 11);
+    }
+    ASSERT_EQ(tracker.use_count(), 1);
+}
+
+TEST(SegmentedSPSCQueueTests, MultithreadedNeverDrops) {
+    constexpr size_t COUNT { 100000 };
+    SegmentedSPSCQueue<std::unique_ptr<size_t>, 64> queue { 2, 4 };
+
+    std::thread producer { [&queue]() {
+        for (size_t i = 0; i < COUNT; ++i) {
+            queue.emplace(std::make_unique<size_t>(i));
+            if (i % 1000 == 0) {
+                std::this_thread::yield();
+            }
+        }
+    } };
+
+    std::unique_ptr<size_t> out;
+    for (size_t i = 0; i < COUNT; ++i) {
+        queue.pop(out);
+        ASSERT_EQ(*out, i);
+    }
+    producer.join();
+    ASSERT_EQ(queue.size(), 0);
+    ASSERT_LE(queue.segments(), 2 + 4 + 1);
+}
+
+TEST(SegmentedSPSCQueueTests, MultithreadedBatches) {
+    constexpr size_t COUNT { 100000 };
+    SegmentedSPSCQueue<size_t, 256, QueueTelemetry<64>> queue;
+
+    std::thread producer { [&queue]() {
+        size_t next { 0 };
+        while (next < COUNT) {
+            auto batch { queue.reserveBatch(std::min<size_t>(COUNT - next, 100)) };
+            for (auto& element : batch) {
+                element = next++;
+            }
+            queue.commitBatch(batch.size());
+            std::this_thread::yield();
+        }
+    } };
+
+    size_t expected { 0 };
+    while (expected < COUNT) {
+        auto batch { queue.peekBatch() };
+        for (auto value : batch) {
+            ASSERT_EQ(value, expected++);
+        }
+        queue.releaseBatch(batch.size());
+        if (batch.empty()) {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    auto stats { queue.stats() };
+    ASSERT_EQ(stats.full_events, 0);
+    ASSERT_EQ(stats.residency_samples, COUNT / 64 + 1);
+}
@@ -0,0 +1,108 @@
+#include "lfds/seqlock.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace lfds;
+
+namespace {
+    // Every field is written with the same value, so a torn read shows up as mismatched fields
+    struct TopOfBook {
+        long bid_price;
+        long bid_qty;
+        long ask_price;
+        long ask_qty;
+    };
+
+    TopOfBook makeBook(long value) {
+        return TopOfBook { value, value, value, value };
+    }
+}
+
+TEST(SeqLockTests, InitialValueAndVersion) {
+    SeqLock<TopOfBook> lock;
+    size_t version { 99 };
+    auto book { lock.load(&version) };
+    ASSERT_EQ(version, 0);
+    ASSERT_EQ(lock.version(), 0);
+    ASSERT_EQ(book.bid_price, 0);
+}
+
+TEST(SeqLockTests, StoreThenLoad) {
+    SeqLock<TopOfBook> lock;
+    lock.store(makeBook(5));
+    lock.store(makeBook(6));
+
+    size_t version;
+    auto book { lock.load(&version) };
+    ASSERT_EQ(version, 2);
+    ASSERT_EQ(lock.version(), 2);
+    ASSERT_EQ(book.ask_qty, 6);
+
+    TopOfBook copy;
+    ASSERT_TRUE(lock.tryLoad(copy));
+    ASSERT_EQ(copy.bid_qty, 6);
+}
+
+// Multi slot version cycles through its slots, readers always get the latest
+TEST(SeqLockTests, MultiSlotReturnsLatest) {
+    SeqLock<TopOfBook, 4> lock;
+    for (long i = 1; i <= 10; ++i) {
+        lock.store(makeBook(i));
+        size_t version;
+        ASSERT_EQ(lock.load(&version).bid_price, i);
+        ASSERT_EQ(version, static_cast<size_t>(i));
+    }
+}
+
+/**
+ * @brief One writer publishing as fast as it can, several readers checking every snapshot they get
+ * is consistent and that versions never go backwards.
+ */
+template<size_t N>
+void readersSeeConsistentSnapshots() {
+    constexpr long NUM_WRITES { 200'000 };
+    constexpr int NUM_READERS { 3 };
+    SeqLock<TopOfBook, N> lock;
+    std::atomic<bool> done { false };
+
+    std::vector<std::thread> readers;
+    std::atomic<int> failures { 0 };
+    for (int r = 0; r < NUM_READERS; ++r) {
+        readers.emplace_back([&lock, &done, &failures]() {
+            size_t last_version { 0 };
+            while (!done.load()) {
+                size_t version;
+                const auto book { lock.load(&version) };
+                if (book.bid_price != book.bid_qty || book.bid_price != book.ask_price || book.bid_price != book.ask_qty ||
+                    static_cast<size_t>(book.bid_price) != version || version < last_version) {
+                    failures.fetch_add(1);
+                }
+                last_version = version;
+            }
+        });
+    }
+
+    for (long i = 1; i <= NUM_WRITES; ++i) {
+        lock.store(makeBook(i));
+        if (i % 1000 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    ASSERT_EQ(failures.load(), 0);
+    ASSERT_EQ(lock.load().bid_price, NUM_WRITES);
+}
+
+TEST(SeqLockTests, ConcurrentReadersSingleSlot) {
+    readersSeeConsistentSnapshots<1>();
+}
+
+TEST(SeqLockTests, ConcurrentReadersMultiSlot) {
+    readersSeeConsistentSnapshots<4>();
+}
@@ -0,0 +1,190 @@
+#include "lfds/shm_spscqueue.hpp"
+#include <gtest/gtest.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace lfds;
+
+namespace {
+    struct Message {
+        long sequence;
+        double price;
+    };
+
+    /**
+     * @brief Segment name unique to this test process, removed again at the end of each test
+     */
+    class ShmSPSCQueueTests : public ::testing::Test {
+    protected:
+        void SetUp() override {
+            name_ = "/hft_test_shm_" + std::to_string(getpid());
+            ShmSPSCQueue<Message>::remove(name_);
+        }
+
+        void TearDown() override {
+            ShmSPSCQueue<Message>::remove(name_);
+        }
+
+        std::string name_;
+    };
+}
+
+// Creator and attacher mappings in the same process see the same ring
+TEST_F(ShmSPSCQueueTests, CreateAndAttach) {
+    ShmSPSCQueue<Message> producer { name_, ShmRole::CREATOR, 8 };
+    ShmSPSCQueue<Message> consumer { name_, ShmRole::ATTACHER, 8 };
+    ASSERT_EQ(consumer.getNextRead(), nullptr);
+
+    *producer.getNextWriteTo() = { 1, 100.5 };
+    producer.updateWriteIndex();
+    ASSERT_EQ(consumer.size(), 1);
+
+    auto read_ptr { consumer.getNextRead() };
+    ASSERT_NE(read_ptr, nullptr);
+    ASSERT_EQ(read_ptr->sequence, 1);
+    ASSERT_EQ(read_ptr->price, 100.5);
+    consumer.updateReadIndex();
+    ASSERT_EQ(producer.size(), 0);
+}
+
+TEST_F(ShmSPSCQueueTests, FullDetectionAcrossMappings) {
+    ShmSPSCQueue<Message> producer { name_, ShmRole::CREATOR, 2 };
+    ShmSPSCQueue<Message> consumer { name_, ShmRole::ATTACHER, 2 };
+
+    for (long i = 0; i < 2; ++i) {
+        ASSERT_FALSE(producer.full());
+        *producer.getNextWriteTo() = { i, 0 };
+        producer.updateWriteIndex();
+    }
+    ASSERT_TRUE(producer.full());
+
+    consumer.updateReadIndex();
+    ASSERT_FALSE(producer.full());
+}
+
+// Messages published before a process goes away are still there for whoever maps the segment next
+TEST_F(ShmSPSCQueueTests, CreatorRestartKeepsPublishedMessages) {
+    {
+        ShmSPSCQueue<Message> producer { name_, ShmRole::CREATOR, 8 };
+        *producer.getNextWriteTo() = { 42, 1.0 };
+        producer.updateWriteIndex();
+
+        // Written but never published, as if the producer died mid-write
+        *producer.getNextWriteTo() = { 43, 1.0 };
+    }
+
+    ShmSPSCQueue<Message> producer { name_, ShmRole::CREATOR, 8 };
+    ShmSPSCQueue<Message> consumer { name_, ShmRole::ATTACHER, 8 };
+    ASSERT_EQ(consumer.size(), 1);
+    ASSERT_EQ(consumer.getNextRead()->sequence, 42);
+    consumer.updateReadIndex();
+    ASSERT_EQ(consumer.getNextRead(), nullptr);
+}
+
+// A creator with a different layout starts the segment from scratch
+TEST_F(ShmSPSCQueueTests, CreatorRejectsMismatchedSegment) {
+    {
+        ShmSPSCQueue<Message> producer { name_, ShmRole::CREATOR, 8 };
+        producer.updateWriteIndex();
+    }
+    ASSERT_DEATH((ShmSPSCQueue<Message> { name_, ShmRole::CREATOR, 16 }), "different layout");
+
+    // The old segment is untouched, and can be replaced once it's removed
+    {
+        ShmSPSCQueue<Message> producer { name_, ShmRole::CREATOR, 8 };
+        ASSERT_EQ(producer.size(), 1);
+    }
+    ShmSPSCQueue<Message>::remove(name_);
+    ShmSPSCQueue<Message> producer { name_, ShmRole::CREATOR, 16 };
+    ASSERT_EQ(producer.size(), 0);
+    ASSERT_EQ(producer.capacity(), 16);
+}
+
+TEST_F(ShmSPSCQueueTests, CreatorReplacesIncompleteSegment) {
+    // Segment whose creator died before setting it up
+    const int fd { shm_open(name_.c_str(), O_CREAT | O_RDWR, 0600) };
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ftruncate(fd, 4096), 0);
+    close(fd);
+
+    ShmSPSCQueue<Message> producer { name_, ShmRole::CREATOR, 8 };
+    ShmSPSCQueue<Message> consumer { name_, ShmRole::ATTACHER, 8 };
+    producer.getNextWriteTo()->sequence = 7;
+    producer.updateWriteIndex();
+    ASSERT_EQ(consumer.getNextRead()->sequence, 7);
+}
+
+// An attacher already waiting on an incomplete segment moves over to the one the creator replaces it with
+TEST_F(ShmSPSCQueueTests, AttacherFollowsReplacedSegment) {
+    const int fd { shm_open(name_.c_str(), O_CREAT | O_RDWR, 0600) };
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ftruncate(fd, 1 << 20), 0);
+    close(fd);
+
+    long received { -1 };
+    std::thread attacher { [&]() {
+        ShmSPSCQueue<Message> consumer { name_, ShmRole::ATTACHER, 8 };
+        Message* read_ptr { nullptr };
+        while (!(read_ptr = consumer.getNextRead())) {
+            std::this_thread::yield();
+        }
+        received = read_ptr->sequence;
+        consumer.updateReadIndex();
+    } };
+    // Give the attacher time to map the incomplete segment and start waiting for it to become ready
+    std::this_thread::sleep_for(std::chrono::milliseconds { 50 });
+
+    ShmSPSCQueue<Message> producer { name_, ShmRole::CREATOR, 8 };
+    producer.getNextWriteTo()->sequence = 7;
+    producer.updateWriteIndex();
+    attacher.join();
+    ASSERT_EQ(received, 7);
+}
+
+TEST_F(ShmSPSCQueueTests, AttachToMismatchedSegmentFails) {
+    ShmSPSCQueue<Message> producer { name_, ShmRole::CREATOR, 16 };
+    ASSERT_DEATH((ShmSPSCQueue<Message> { name_, ShmRole::ATTACHER, 8 }), "different layout");
+}
+
+TEST_F(ShmSPSCQueueTests, AttachWithoutCreatorTimesOut) {
+    ASSERT_DEATH((ShmSPSCQueue<Message> { name_, ShmRole::ATTACHER, 8, std::chrono::milliseconds { 20 } }), "Timed out attaching");
+}
+
+TEST_F(ShmSPSCQueueTests, CapacityMustBePowerOfTwo) {
+    ASSERT_DEATH((ShmSPSCQueue<Message> { name_, ShmRole::CREATOR, 6 }), "power of two");
+}
+
+// Producer in a child process, consumer in this one
+TEST_F(ShmSPSCQueueTests, CrossProcess) {
+    constexpr long NUM_MESSAGES { 100'000 };
+    ShmSPSCQueue<Message> consumer { name_, ShmRole::CREATOR, 64 };
+
+    const pid_t child { fork() };
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        ShmSPSCQueue<Message> producer { name_, ShmRole::ATTACHER, 64 };
+        for (long i = 0; i < NUM_MESSAGES; ++i) {
+            while (producer.full()) {
+                std::this_thread::yield();
+            }
+            *producer.getNextWriteTo() = { i, i * 0.5 };
+            producer.updateWriteIndex();
+        }
+        _exit(0);
+    }
+
+    for (long i = 0; i < NUM_MESSAGES; ++i) {
+        Message* read_ptr { nullptr };
+        while (!(read_ptr = consumer.getNextRead())) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(read_ptr->sequence, i);
+        ASSERT_EQ(read_ptr->price, i * 0.5);
+        consumer.updateReadIndex();
+    }
+
+    int status;
+    ASSERT_EQ(waitpid(child, &status, 0), child);
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
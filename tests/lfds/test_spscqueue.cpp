@@ -1,6 +1,8 @@
 #include "lfds/spscqueue.hpp"
 #include <gtest/gtest.h>
 #include <thread>
+#include <memory>
+#include <atomic>
 
 using namespace lfds;
 
@@ -112,3 +114,412 @@ TEST(SPSCQueueTests, BasicMultithreadedProducerConsumer) {
     producerThread.join();
     consumerThread.join();
 }
+
+// Size should reflect elements written but not yet read
+TEST(SPSCQueueTests, SizeTracksUnreadElements) {
+    SPSCQueue<int> queue { 4 };
+    ASSERT_EQ(queue.size(), 0);
+    ASSERT_EQ(queue.capacity(), 4);
+
+    for (int i = 0; i < 3; ++i) {
+        *queue.getNextWriteTo() = i;
+        queue.updateWriteIndex();
+    }
+    ASSERT_EQ(queue.size(), 3);
+
+    queue.updateReadIndex();
+    ASSERT_EQ(queue.size(), 2);
+}
+
+// Producer should see the queue as full once every slot holds an unread element, and not full again after a read
+TEST(SPSCQueueTests, FullDetection) {
+    SPSCQueue<int> queue { 2 };
+    ASSERT_FALSE(queue.full());
+
+    *queue.getNextWriteTo() = 1;
+    queue.updateWriteIndex();
+    ASSERT_FALSE(queue.full());
+
+    *queue.getNextWriteTo() = 2;
+    queue.updateWriteIndex();
+    ASSERT_TRUE(queue.full());
+
+    queue.updateReadIndex();
+    ASSERT_FALSE(queue.full());
+}
+
+// Reading past the last written element is a bug in the caller
+TEST(SPSCQueueTests, ReadIndexPastWriteIndexFails) {
+    SPSCQueue<int> queue { 2 };
+    ASSERT_DEATH(queue.updateReadIndex(), "Attempted to read from empty queue!");
+}
+
+// Many more elements than slots, with the producer backing off whenever the consumer falls behind
+TEST(SPSCQueueTests, MultithreadedWrapAround) {
+    const int NUM_ITEMS { 100'000 };
+    SPSCQueue<int> queue { 64 };
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < NUM_ITEMS; ++i) {
+            while (queue.full()) {
+                std::this_thread::yield();
+            }
+            *queue.getNextWriteTo() = i;
+            queue.updateWriteIndex();
+        }
+    });
+
+    for (int i = 0; i < NUM_ITEMS; ++i) {
+        int* read_ptr { nullptr };
+        while (!(read_ptr = queue.getNextRead())) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(*read_ptr, i);
+        queue.updateReadIndex();
+    }
+
+    producer.join();
+    ASSERT_EQ(queue.size(), 0);
+}
+
+// Compile time capacity queue should behave exactly like the dynamic one
+TEST(SPSCQueueTests, StaticCapacityWrapAround) {
+    SPSCQueue<int, 4> queue;
+    static_assert(queue.capacity() == 4);
+
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_FALSE(queue.full());
+        *queue.getNextWriteTo() = i;
+        queue.updateWriteIndex();
+
+        auto read_ptr { queue.getNextRead() };
+        ASSERT_NE(read_ptr, nullptr);
+        ASSERT_EQ(*read_ptr, i);
+        queue.updateReadIndex();
+    }
+    ASSERT_EQ(queue.getNextRead(), nullptr);
+}
+
+// Storage of a compile time capacity queue lives inside the queue object itself
+TEST(SPSCQueueTests, StaticCapacityStorageIsInline) {
+    SPSCQueue<int, 8> queue;
+    auto first { reinterpret_cast<const char*>(queue.getNextWriteTo()) };
+    auto self { reinterpret_cast<const char*>(&queue) };
+
+    ASSERT_GE(first, self);
+    ASSERT_LT(first, self + sizeof(queue));
+}
+
+TEST(SPSCQueueTests, StaticCapacityMultithreaded) {
+    const int NUM_ITEMS { 100'000 };
+    SPSCQueue<int, 16> queue;
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < NUM_ITEMS; ++i) {
+            while (queue.full()) {
+                std::this_thread::yield();
+            }
+            *queue.getNextWriteTo() = i;
+            queue.updateWriteIndex();
+        }
+    });
+
+    for (int i = 0; i < NUM_ITEMS; ++i) {
+        int* read_ptr { nullptr };
+        while (!(read_ptr = queue.getNextRead())) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(*read_ptr, i);
+        queue.updateReadIndex();
+    }
+
+    producer.join();
+}
+
+// A batch is published with one commit, and the consumer sees all of it at once
+TEST(SPSCQueueTests, BatchReserveCommitPeekRelease) {
+    SPSCQueue<int> queue { 8 };
+
+    auto batch { queue.reserveBatch(5) };
+    ASSERT_EQ(batch.size(), 5);
+    for (int i = 0; i < 5; ++i) {
+        batch[i] = i;
+    }
+
+    // Nothing visible until committed
+    ASSERT_TRUE(queue.peekBatch().empty());
+    queue.commitBatch(batch.size());
+    ASSERT_EQ(queue.size(), 5);
+
+    auto read { queue.peekBatch() };
+    ASSERT_EQ(read.size(), 5);
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(read[i], i);
+    }
+
+    // Release part of the batch, the rest should still be there
+    queue.releaseBatch(2);
+    read = queue.peekBatch(10);
+    ASSERT_EQ(read.size(), 3);
+    ASSERT_EQ(read[0], 2);
+    queue.releaseBatch(3);
+    ASSERT_EQ(queue.size(), 0);
+}
+
+// Batches stop at the end of the ring and at the amount of free space
+TEST(SPSCQueueTests, BatchWrapAroundAndFull) {
+    SPSCQueue<int, 8> queue;
+
+    queue.commitBatch(queue.reserveBatch(6).size());
+    queue.releaseBatch(queue.peekBatch().size());
+
+    // Write index is at slot 6, so only 2 contiguous slots are available before wrapping
+    auto first { queue.reserveBatch(5) };
+    ASSERT_EQ(first.size(), 2);
+    first[0] = 10;
+    first[1] = 11;
+    queue.commitBatch(first.size());
+
+    auto second { queue.reserveBatch(3) };
+    ASSERT_EQ(second.size(), 3);
+    ASSERT_EQ(second.data(), first.data() - 6);  // Wrapped back around to slot 0
+    second[0] = 12;
+    second[1] = 13;
+    second[2] = 14;
+    queue.commitBatch(second.size());
+
+    // 5 used, 3 free
+    ASSERT_EQ(queue.reserveBatch(8).size(), 3);
+    queue.commitBatch(3);
+    ASSERT_TRUE(queue.reserveBatch(1).empty());
+    ASSERT_TRUE(queue.full());
+
+    // Consumer sees the elements in two contiguous pieces
+    auto read { queue.peekBatch() };
+    ASSERT_EQ(read.size(), 2);
+    ASSERT_EQ(read[0], 10);
+    ASSERT_EQ(read[1], 11);
+    queue.releaseBatch(read.size());
+
+    read = queue.peekBatch(3);
+    ASSERT_EQ(read.size(), 3);
+    ASSERT_EQ(read[0], 12);
+    ASSERT_EQ(read[2], 14);
+}
+
+TEST(SPSCQueueTests, ReleasingUnreadBatchFails) {
+    SPSCQueue<int> queue { 4 };
+    queue.commitBatch(queue.reserveBatch(2).size());
+    queue.peekBatch();
+    ASSERT_DEATH(queue.releaseBatch(3), "Attempted to release more elements than were read!");
+}
+
+TEST(SPSCQueueTests, BatchMultithreaded) {
+    const int NUM_ITEMS { 100'000 };
+    SPSCQueue<int> queue { 100 };
+
+    std::thread producer([&queue]() {
+        int next { 0 };
+        while (next < NUM_ITEMS) {
+            auto batch { queue.reserveBatch(std::min(7, NUM_ITEMS - next)) };
+            for (auto& element : batch) {
+                element = next++;
+            }
+            queue.commitBatch(batch.size());
+            if (batch.empty()) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    int expected { 0 };
+    while (expected < NUM_ITEMS) {
+        auto batch { queue.peekBatch(13) };
+        for (auto element : batch) {
+            ASSERT_EQ(element, expected++);
+        }
+        queue.releaseBatch(batch.size());
+        if (batch.empty()) {
+            std::this_thread::yield();
+        }
+    }
+
+    producer.join();
+}
+
+namespace {
+    // Counts live instances, and can only be constructed from a value
+    struct Tracked {
+        static inline int live { 0 };
+        int value;
+
+        explicit Tracked(int v) : value { v } { ++live; }
+        Tracked(Tracked&& other) noexcept : value { other.value } { ++live; }
+        Tracked& operator=(Tracked&& other) noexcept { value = other.value; return *this; }
+        ~Tracked() { --live; }
+    };
+}
+
+// No elements exist until they are pushed, and they are destroyed once consumed
+TEST(SPSCQueueTests, ElementsConstructedOnPushDestroyedOnPop) {
+    Tracked::live = 0;
+    {
+        SPSCQueue<Tracked> queue { 4 };
+        ASSERT_EQ(Tracked::live, 0);
+
+        queue.emplace(1);
+        ASSERT_TRUE(queue.tryEmplace(2));
+        ASSERT_TRUE(queue.tryPush(Tracked { 3 }));
+        ASSERT_EQ(Tracked::live, 3);
+
+        Tracked out { 0 };
+        ASSERT_TRUE(queue.tryPop(out));
+        ASSERT_EQ(out.value, 1);
+        ASSERT_EQ(Tracked::live, 3);
+
+        queue.pop(out);
+        ASSERT_EQ(out.value, 2);
+        ASSERT_EQ(Tracked::live, 2);
+    }
+    // Queue destroys what was never popped
+    ASSERT_EQ(Tracked::live, 0);
+}
+
+TEST(SPSCQueueTests, TryPushFullTryPopEmpty) {
+    SPSCQueue<int, 2> queue;
+    ASSERT_TRUE(queue.tryPush(1));
+    ASSERT_TRUE(queue.tryPush(2));
+    ASSERT_FALSE(queue.tryPush(3));
+
+    int out;
+    ASSERT_TRUE(queue.tryPop(out));
+    ASSERT_TRUE(queue.tryPop(out));
+    ASSERT_EQ(out, 2);
+    ASSERT_FALSE(queue.tryPop(out));
+}
+
+// Default policy never hands out a slot the consumer hasn't read yet
+TEST(SPSCQueueTests, FailFastOnFullQueue) {
+    SPSCQueue<int> queue { 1 };
+    *queue.getNextWriteTo() = 1;
+    queue.updateWriteIndex();
+    ASSERT_DEATH(queue.getNextWriteTo(), "Attempted to write to full queue!");
+    ASSERT_FALSE(queue.push(2));
+    ASSERT_EQ(queue.overflows(), 0);
+    ASSERT_DEATH(queue.commitBatch(1), "Attempted to commit more elements than were reserved!");
+
+    int out;
+    ASSERT_TRUE(queue.tryPop(out));
+    ASSERT_EQ(out, 1);
+}
+
+TEST(SPSCQueueTests, DropNewestCountsDrops) {
+    SPSCQueue<int, 2, QueueOverflow::DROP_NEWEST> queue;
+    ASSERT_TRUE(queue.push(1));
+    ASSERT_TRUE(queue.push(2));
+    ASSERT_FALSE(queue.push(3));
+    ASSERT_EQ(queue.getNextWriteTo(), nullptr);
+    ASSERT_TRUE(queue.reserveBatch(5).empty());
+    ASSERT_EQ(queue.overflows(), 1 + 1 + 5);
+
+    // What was already queued is untouched
+    int out;
+    queue.pop(out);
+    ASSERT_EQ(out, 1);
+    queue.pop(out);
+    ASSERT_EQ(out, 2);
+}
+
+TEST(SPSCQueueTests, OverwriteOldestCountsLaps) {
+    SPSCQueue<int, 4, QueueOverflow::OVERWRITE_OLDEST> queue;
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(queue.push(i));
+    }
+    ASSERT_EQ(queue.size(), 4);
+    ASSERT_EQ(queue.overflows(), 6);
+
+    // Consumer gets the newest capacity() elements
+    int out;
+    for (int i = 6; i < 10; ++i) {
+        ASSERT_TRUE(queue.tryPop(out));
+        ASSERT_EQ(out, i);
+    }
+    ASSERT_FALSE(queue.tryPop(out));
+}
+
+// Producer waits for the consumer instead of failing, so nothing is lost
+TEST(SPSCQueueTests, SpinUntilSpaceMultithreaded) {
+    const int NUM_ITEMS { 100'000 };
+    SPSCQueue<int, 16, QueueOverflow::SPIN_UNTIL_SPACE> queue;
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < NUM_ITEMS; i += 2) {
+            ASSERT_TRUE(queue.push(i));
+            *queue.getNextWriteTo() = i + 1;
+            queue.updateWriteIndex();
+        }
+    });
+
+    int out;
+    for (int i = 0; i < NUM_ITEMS; ++i) {
+        queue.pop(out);
+        ASSERT_EQ(out, i);
+    }
+    producer.join();
+    ASSERT_EQ(queue.overflows(), 0);
+}
+
+/**
+ * @brief Producer never waits for a slow consumer. Consumer may miss elements, but never sees one twice, out of order,
+ * or torn, and everything is either read or counted as overwritten.
+ */
+TEST(SPSCQueueTests, OverwriteOldestMultithreaded) {
+    const size_t NUM_ITEMS { 100'000 };
+    struct Pair { size_t first; size_t second; };
+    SPSCQueue<Pair, 8, QueueOverflow::OVERWRITE_OLDEST> queue;
+    std::atomic<bool> done { false };
+
+    std::thread producer([&]() {
+        for (size_t i = 0; i < NUM_ITEMS; ++i) {
+            ASSERT_TRUE(queue.push(Pair { i, i }));
+        }
+        done = true;
+    });
+
+    size_t seen { 0 };
+    size_t next { 0 };
+    Pair out;
+    while (!done || queue.size()) {
+        if (!queue.tryPop(out)) {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(out.first, out.second);
+        ASSERT_GE(out.first, next);
+        next = out.first + 1;
+        ++seen;
+    }
+    producer.join();
+    ASSERT_EQ(seen + queue.overflows(), NUM_ITEMS);
+}
+
+// Move only elements go through the queue without copies
+TEST(SPSCQueueTests, MoveOnlyMultithreaded) {
+    const int NUM_ITEMS { 100'000 };
+    SPSCQueue<std::unique_ptr<int>, 64, QueueOverflow::SPIN_UNTIL_SPACE> queue;
+
+    std::thread producer([&queue]() {
+        for (int i = 0; i < NUM_ITEMS; ++i) {
+            queue.push(std::make_unique<int>(i));
+        }
+    });
+
+    std::unique_ptr<int> out;
+    for (int i = 0; i < NUM_ITEMS; ++i) {
+        queue.pop(out);
+        ASSERT_EQ(*out, i);
+    }
+
+    producer.join();
+    ASSERT_EQ(queue.size(), 0);
+}
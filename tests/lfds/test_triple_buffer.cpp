@@ -0,0 +1,86 @@
+#include "lfds/triple_buffer.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+
+using namespace lfds;
+
+namespace {
+    // Every field is written with the same value, so a torn read shows up as mismatched fields
+    struct FairValue {
+        long bid;
+        long ask;
+        long mid;
+        long sequence;
+    };
+
+    FairValue makeValue(long value) {
+        return FairValue { value, value, value, value };
+    }
+}
+
+TEST(TripleBufferTests, InitialValue) {
+    TripleBuffer<FairValue> buffer { makeValue(7) };
+    ASSERT_FALSE(buffer.update());
+    ASSERT_EQ(buffer.read().sequence, 7);
+}
+
+// Reader only ever sees the latest value, however many were published in between
+TEST(TripleBufferTests, LatestValueWins) {
+    TripleBuffer<FairValue> buffer;
+    for (long i = 1; i <= 5; ++i) {
+        buffer.write(makeValue(i));
+    }
+    ASSERT_TRUE(buffer.update());
+    ASSERT_EQ(buffer.read().sequence, 5);
+    ASSERT_FALSE(buffer.update());
+    ASSERT_EQ(buffer.read().sequence, 5);
+
+    auto& next { buffer.writeBuffer() };
+    next = makeValue(6);
+    // Not visible until published
+    ASSERT_EQ(buffer.read().sequence, 5);
+    buffer.publish();
+    ASSERT_EQ(buffer.read().sequence, 6);
+}
+
+// Value the reader holds is never touched by the writer until the reader moves on
+TEST(TripleBufferTests, ReaderValueStable) {
+    TripleBuffer<FairValue> buffer;
+    buffer.write(makeValue(1));
+    const auto& held { buffer.read() };
+    for (long i = 2; i < 10; ++i) {
+        buffer.write(makeValue(i));
+        ASSERT_EQ(held.sequence, 1);
+    }
+    ASSERT_EQ(buffer.read().sequence, 9);
+}
+
+TEST(TripleBufferTests, MultithreadedNoTornOrStaleReads) {
+    constexpr long COUNT { 100000 };
+    TripleBuffer<FairValue> buffer;
+    std::atomic<bool> done { false };
+
+    std::thread writer { [&buffer, &done]() {
+        for (long i = 1; i <= COUNT; ++i) {
+            buffer.write(makeValue(i));
+            if (i % 64 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+    } };
+
+    long last { 0 };
+    while (!done.load() || last != COUNT) {
+        const auto& value { buffer.read() };
+        ASSERT_EQ(value.bid, value.sequence);
+        ASSERT_EQ(value.ask, value.sequence);
+        ASSERT_EQ(value.mid, value.sequence);
+        ASSERT_GE(value.sequence, last);
+        last = value.sequence;
+        std::this_thread::yield();
+    }
+    writer.join();
+    ASSERT_EQ(last, COUNT);
+}
@@ -0,0 +1,75 @@
+#include "lfds/wait_strategy.hpp"
+#include "lfds/spscqueue.hpp"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace lfds;
+
+template<typename WaitStrategy>
+class WaitStrategyTests : public ::testing::Test {};
+
+using WaitStrategies = ::testing::Types<BusySpinWait, PauseSpinWait, SpinThenYieldWait<>, FutexWait<>, FutexWait<0>>;
+TYPED_TEST_SUITE(WaitStrategyTests, WaitStrategies);
+
+// Condition already true - wait returns straight away
+TYPED_TEST(WaitStrategyTests, ReturnsImmediatelyWhenReady) {
+    TypeParam wait_strategy;
+    int checks { 0 };
+    wait_strategy.wait([&checks]() { ++checks; return true; });
+    ASSERT_EQ(checks, 1);
+}
+
+// Consumer waits on a queue while a producer pushes to it, notifying after every element
+TYPED_TEST(WaitStrategyTests, ConsumerWakesForEveryElement) {
+    constexpr int NUM_ITEMS { 2'000 };
+    SPSCQueue<int> queue { 16 };
+    TypeParam wait_strategy;
+
+    std::thread consumer([&queue, &wait_strategy]() {
+        for (int i = 0; i < NUM_ITEMS; ++i) {
+            wait_strategy.wait([&queue]() { return queue.getNextRead() != nullptr; });
+            ASSERT_EQ(*queue.getNextRead(), i);
+            queue.updateReadIndex();
+        }
+    });
+
+    for (int i = 0; i < NUM_ITEMS; ++i) {
+        while (queue.full()) {
+            std::this_thread::yield();
+        }
+        *queue.getNextWriteTo() = i;
+        queue.updateWriteIndex();
+        wait_strategy.notify();
+
+        // Give the consumer a chance to run dry and go to sleep now and then
+        if (i % 100 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds { 200 });
+        }
+    }
+
+    consumer.join();
+}
+
+// Consumer parks on the futex once it has spun out, and is woken up by notify()
+TEST(FutexWaitTests, ParksUntilNotified) {
+    FutexWait<0> wait_strategy;
+    std::atomic<bool> ready { false };
+    std::atomic<bool> woken { false };
+
+    std::thread consumer([&]() {
+        wait_strategy.wait([&ready]() { return ready.load(); });
+        woken = true;
+    });
+
+    while (!wait_strategy.parked()) {
+        std::this_thread::yield();
+    }
+    ASSERT_FALSE(woken.load());
+
+    ready = true;
+    wait_strategy.notify();
+    consumer.join();
+
+    ASSERT_TRUE(woken.load());
+    ASSERT_FALSE(wait_strategy.parked());
+}
@@ -0,0 +1,116 @@
+#include "utils/mempool/concurrent_mempool.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+    struct Order {
+        long id;
+        long owner;
+        explicit Order(long id, long owner = 0)
+            : id { id }, owner { owner }
+        {}
+    };
+}
+
+TEST(ConcurrentMemPoolTests, AllocateAndReuse) {
+    ConcurrentMemPool<Order> pool { 4 };
+    auto first { pool.allocate(1) };
+    ASSERT_EQ(first->id, 1);
+    pool.deallocate(first);
+
+    auto second { pool.allocate(2) };
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(second->id, 2);
+}
+
+TEST(ConcurrentMemPoolTests, PoolExhaustion) {
+    ConcurrentMemPool<Order, 4> pool { 3 };
+    auto cache { pool.cache() };
+    for (int i = 0; i < 3; ++i) {
+        cache.allocate(i);
+    }
+    ASSERT_DEATH(cache.allocate(3), "Memory pool out of space.");
+    ASSERT_DEATH(pool.allocate(3), "Memory pool out of space.");
+}
+
+TEST(ConcurrentMemPoolTests, InvalidDeallocation) {
+    ConcurrentMemPool<Order> pool { 4 };
+    Order not_in_pool { 5 };
+    ASSERT_DEATH(pool.deallocate(&not_in_pool), "Pointer provided doesn't point to something in this pool.");
+}
+
+// Blocks freed through one cache can be allocated through another, and a destroyed cache hands its blocks back
+TEST(ConcurrentMemPoolTests, CachesShareBlocks) {
+    ConcurrentMemPool<Order, 4> pool { 8 };
+    std::vector<Order*> orders;
+    {
+        auto strategy { pool.cache() };
+        for (int i = 0; i < 8; ++i) {
+            orders.push_back(strategy.allocate(i));
+        }
+        auto gateway { pool.cache() };
+        for (auto order : orders) {
+            gateway.deallocate(order);
+        }
+    }
+
+    auto cache { pool.cache() };
+    std::set<Order*> reallocated;
+    for (int i = 0; i < 8; ++i) {
+        reallocated.insert(cache.allocate(i));
+    }
+    ASSERT_EQ(reallocated, std::set<Order*>(orders.begin(), orders.end()));
+}
+
+// Threads allocate, swap objects with each other, and free what they got from another thread. No object is ever
+// handed to two threads at once, and every block comes back.
+TEST(ConcurrentMemPoolTests, MultithreadedCrossThreadFree) {
+    static constexpr size_t SIZE { 512 };
+    static constexpr long ITERATIONS { 100000 };
+    static constexpr long THREADS { 4 };
+    ConcurrentMemPool<Order, 16> pool { SIZE };
+    std::array<std::atomic<Order*>, 64> exchange {};
+
+    auto work { [&pool, &exchange](long thread) {
+        auto cache { pool.cache() };
+        for (long i = 0; i < ITERATIONS; ++i) {
+            auto order { cache.allocate(i, thread) };
+            if (i % 256 == 0) {
+                std::this_thread::yield();
+            }
+            // If the block had also been handed to another thread, it would have overwritten these by now
+            ASSERT_EQ(order->id, i);
+            ASSERT_EQ(order->owner, thread);
+
+            auto previous { exchange[(i * 7 + thread) % exchange.size()].exchange(order) };
+            if (previous) {
+                ASSERT_LT(previous->owner, THREADS);
+                cache.deallocate(previous);
+            }
+        }
+    } };
+
+    std::vector<std::thread> threads;
+    for (long t = 0; t < THREADS; ++t) {
+        threads.emplace_back(work, t);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (auto& slot : exchange) {
+        if (auto order { slot.exchange(nullptr) }) {
+            pool.deallocate(order);
+        }
+    }
+
+    std::set<Order*> all;
+    for (size_t i = 0; i < SIZE; ++i) {
+        all.insert(pool.allocate(i));
+    }
+    ASSERT_EQ(all.size(), SIZE);
+}
@@ -0,0 +1,163 @@
+#include "utils/mempool/growable_mempool.hpp"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+    struct Order {
+        long id;
+        explicit Order(long id)
+            : id { id }
+        {}
+    };
+
+    struct Tracked {
+        static inline int live { 0 };
+        Tracked() { ++live; }
+        ~Tracked() { --live; }
+    };
+
+    // Heap memory whose allocations can be held up, to catch the grower part way through growing the pool
+    struct GatedMemory {
+        static inline std::atomic<bool> hold { false };
+        static inline std::atomic<bool> holding { false };
+
+        static void* allocate(size_t bytes) {
+            if (hold) {
+                holding = true;
+                while (hold) {
+                    std::this_thread::yield();
+                }
+            }
+            return HeapMemory::allocate(bytes);
+        }
+
+        static void deallocate(void* ptr, size_t bytes) noexcept {
+            HeapMemory::deallocate(ptr, bytes);
+        }
+    };
+}
+
+TEST(GrowableMemPoolTests, AllocateAndReuse) {
+    GrowableMemPool<Order, 4> pool { 1 };
+    auto first { pool.allocate(1) };
+    ASSERT_EQ(first->id, 1);
+    pool.deallocate(first);
+
+    auto second { pool.allocate(2) };
+    ASSERT_EQ(first, second);
+    ASSERT_EQ(second->id, 2);
+    ASSERT_EQ(pool.allocated(), 1);
+}
+
+TEST(GrowableMemPoolTests, PointersStayValidAcrossGrowth) {
+    GrowableMemPool<Order, 16> pool { 1 };
+    std::vector<Order*> orders;
+    for (long i = 0; i < 1000; ++i) {
+        orders.push_back(pool.allocate(i));
+    }
+
+    // Grew on demand, and nothing allocated before moved
+    ASSERT_EQ(pool.chunks(), 1000 / 16 + 1);
+    for (long i = 0; i < 1000; ++i) {
+        ASSERT_EQ(orders[i]->id, i);
+    }
+    for (auto order : orders) {
+        pool.deallocate(order);
+    }
+    ASSERT_EQ(pool.allocated(), 0);
+}
+
+TEST(GrowableMemPoolTests, ReserveUpFront) {
+    GrowableMemPool<Order, 4> pool { 1, 5 };
+    ASSERT_EQ(pool.capacity(), 4);
+
+    ASSERT_TRUE(pool.reserve(18));
+    ASSERT_EQ(pool.chunks(), 5);
+    ASSERT_EQ(pool.capacity(), 20);
+
+    // Past max_chunks
+    ASSERT_FALSE(pool.reserve(21));
+    ASSERT_EQ(pool.chunks(), 5);
+}
+
+TEST(GrowableMemPoolTests, PoolExhaustion) {
+    GrowableMemPool<Order, 4> pool { 1, 2 };
+    for (long i = 0; i < 8; ++i) {
+        pool.allocate(i);
+    }
+    ASSERT_DEATH(pool.allocate(8), "Memory pool out of space.");
+}
+
+TEST(GrowableMemPoolTests, GrowerAddsChunkAtHighWaterMark) {
+    GrowableMemPool<Order, 8> pool { 1, 16, 0.5 };
+    pool.startGrower();
+
+    std::vector<Order*> orders;
+    for (long i = 0; i < 4; ++i) {
+        orders.push_back(pool.allocate(i));
+    }
+
+    // Half the pool in use, so the grower should add a chunk before it runs dry
+    const auto deadline { std::chrono::steady_clock::now() + std::chrono::seconds(5) };
+    while (pool.chunks() < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(pool.chunks(), 2);
+
+    for (long i = 4; i < 16; ++i) {
+        orders.push_back(pool.allocate(i));
+    }
+    for (long i = 0; i < 16; ++i) {
+        ASSERT_EQ(orders[i]->id, i);
+    }
+}
+
+// The grower must still see the stop if the pool is destroyed while it's adding a chunk, or the destructor never returns
+TEST(GrowableMemPoolTests, DestroyWhileGrowing) {
+    std::thread releaser;
+    {
+        GrowableMemPool<long, 8, GatedMemory> pool { 1, 16, 0.5 };
+        pool.startGrower();
+        GatedMemory::hold = true;
+        for (long i = 0; i < 4; ++i) {
+            pool.allocate(i);
+        }
+        while (!GatedMemory::holding) {
+            std::this_thread::yield();
+        }
+
+        // Let the grower finish its chunk once the destructor has asked it to stop
+        releaser = std::thread { []() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            GatedMemory::hold = false;
+        } };
+    }
+    releaser.join();
+}
+
+TEST(GrowableMemPoolTests, OnlyAllocatedObjectsDestroyed) {
+    {
+        GrowableMemPool<Tracked, 4> pool { 1 };
+        std::vector<Tracked*> objs;
+        for (int i = 0; i < 6; ++i) {
+            objs.push_back(pool.allocate());
+        }
+        pool.deallocate(objs[0]);
+        pool.deallocate(objs[5]);
+        ASSERT_EQ(Tracked::live, 4);
+    }
+    ASSERT_EQ(Tracked::live, 0);
+}
+
+#ifndef NDEBUG
+TEST(GrowableMemPoolTests, InvalidDeallocation) {
+    GrowableMemPool<Order, 4> pool { 1 };
+    Order not_in_pool { 1 };
+    ASSERT_DEATH(pool.deallocate(&not_in_pool), "Pointer provided doesn't point to something in this pool.");
+}
+#endif
@@ -0,0 +1,59 @@
+#include "utils/memory.hpp"
+#include "utils/mempool/mempool.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+    template<typename Memory>
+    void checkRegion(size_t bytes) {
+        auto ptr { static_cast<char*>(Memory::allocate(bytes)) };
+        ASSERT_NE(ptr, nullptr);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % CACHE_LINE_SIZE, 0);
+
+        // Whole region is usable
+        std::memset(ptr, 0xab, bytes);
+        ASSERT_EQ(ptr[0], static_cast<char>(0xab));
+        ASSERT_EQ(ptr[bytes - 1], static_cast<char>(0xab));
+        Memory::deallocate(ptr, bytes);
+    }
+}
+
+TEST(MemoryTests, HeapMemory) {
+    checkRegion<HeapMemory>(100);
+    checkRegion<HeapMemory>(3 * HUGE_PAGE_SIZE);
+}
+
+// Works whether or not huge pages are reserved on this machine - without them, falls back to a THP advised mapping
+TEST(MemoryTests, HugePageMemory) {
+    checkRegion<HugePageMemory<>>(100);
+    checkRegion<HugePageMemory<>>(3 * HUGE_PAGE_SIZE + 1);
+    checkRegion<HugePageMemory<false>>(HUGE_PAGE_SIZE);
+    checkRegion<HugePageMemory<true, true>>(HUGE_PAGE_SIZE);
+}
+
+// Huge page regions always start on a huge page boundary, so the kernel can back them with huge pages
+TEST(MemoryTests, HugePageMemoryIsHugePageAligned) {
+    for (int i = 0; i < 4; ++i) {
+        auto ptr { HugePageMemory<false>::allocate(REGULAR_PAGE_SIZE) };
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(ptr) % HUGE_PAGE_SIZE, 0);
+        HugePageMemory<false>::deallocate(ptr, REGULAR_PAGE_SIZE);
+    }
+}
+
+TEST(MemoryTests, AllocatorWorksWithVector) {
+    std::vector<int, MemoryAllocator<int, HugePageMemory<>>> values;
+    for (int i = 0; i < 100'000; ++i) {
+        values.push_back(i);
+    }
+    ASSERT_EQ(values[99'999], 99'999);
+}
+
+TEST(MemoryTests, MemPoolWithHugePages) {
+    MemPool<int, DYNAMIC_CAPACITY, HugePageMemory<>> pool { 1000 };
+    auto value { pool.allocate(42) };
+    ASSERT_EQ(*value, 42);
+    pool.deallocate(value);
+}
@@ -1,5 +1,9 @@
 #include "utils/mempool/mempool.hpp"
 #include <gtest/gtest.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <string>
 
 using namespace utils;
 
@@ -76,7 +80,9 @@ TEST(MemPoolTests, InvalidDeallocation) {
     TestObj* InPool { pool.allocate(1) };
     pool.deallocate(InPool);
 
+#ifndef NDEBUG
     ASSERT_DEATH(pool.deallocate(InPool), "Attempted to deallocate unallocated entry in pool.");
+#endif
 }
 
 TEST(MemPoolTests, ObjectReuseAfterDeallocation) {
@@ -119,5 +125,154 @@ TEST(MemPoolTests, ResizedPoolIntegrity) {
     ASSERT_EQ(obj->getValue(), 50);
 }
 
+TEST(MemPoolTests, FreedBlocksReusedMostRecentFirst) {
+    MemPool pool { MemPool<TestObj>{ 4 } };
 
+    TestObj* obj1 { pool.allocate(1) };
+    pool.allocate(2);
+    TestObj* obj3 { pool.allocate(3) };
 
+    pool.deallocate(obj1);
+    pool.deallocate(obj3);
+
+    ASSERT_EQ(pool.allocate(4), obj3);
+    ASSERT_EQ(pool.allocate(5), obj1);
+    TestObj* obj4 { pool.allocate(6) };
+    ASSERT_NE(obj4, obj1);
+    ASSERT_NE(obj4, obj3);
+    ASSERT_DEATH(pool.allocate(7), "Memory pool out of space.");
+}
+
+TEST(MemPoolTests, FillDrainAndRefill) {
+    constexpr int SIZE { 10'000 };
+    MemPool pool { MemPool<TestObj>{ SIZE } };
+    std::vector<TestObj*> objs;
+
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < SIZE; ++i) {
+            objs.push_back(pool.allocate(i));
+        }
+        for (int i = 0; i < SIZE; ++i) {
+            ASSERT_EQ(objs[i]->getValue(), i);
+            pool.deallocate(objs[i]);
+        }
+        objs.clear();
+    }
+}
+
+struct Tracked {
+    static inline int live { 0 };
+    explicit Tracked(int) { ++live; }
+    ~Tracked() { --live; }
+};
+
+TEST(MemPoolTests, OnlyAllocatedObjectsDestroyed) {
+    {
+        MemPool pool { MemPool<Tracked>{ 5 } };
+        auto obj { pool.allocate(1) };
+        pool.allocate(2);
+        pool.allocate(3);
+        ASSERT_EQ(Tracked::live, 3);
+
+        pool.deallocate(obj);
+        ASSERT_EQ(Tracked::live, 2);
+
+        // Shrinking destroys the object that no longer fits
+        pool.resize(2);
+        ASSERT_EQ(Tracked::live, 1);
+    }
+    ASSERT_EQ(Tracked::live, 0);
+}
+
+// Growing moves objects properly, rather than copying their bytes (a short string points into itself)
+TEST(MemPoolTests, GrowingMovesNonTrivialObjects) {
+    MemPool pool { MemPool<std::string>{ 2 } };
+    auto short_handle { pool.handleOf(pool.allocate("short")) };
+    auto long_handle { pool.handleOf(pool.allocate(100, 'x')) };
+
+    pool.resize(1024);
+    ASSERT_EQ(*pool.get(short_handle), "short");
+    ASSERT_EQ(*pool.get(long_handle), std::string(100, 'x'));
+
+    pool.get(short_handle)->append(" and longer than the small string buffer");
+    ASSERT_EQ(*pool.get(short_handle), "short and longer than the small string buffer");
+    pool.deallocate(short_handle);
+    pool.deallocate(long_handle);
+}
+
+TEST(MemPoolTests, StaticPoolHoldsStorageInline) {
+    struct Owner {
+        int id;
+        MemPool<TestObj, 8> pool;
+    };
+    static_assert(sizeof(Owner) >= 8 * sizeof(TestObj));
+
+    Owner owner {};
+    ASSERT_EQ(owner.pool.capacity(), 8);
+
+    std::vector<TestObj*> objs;
+    for (int i = 0; i < 8; ++i) {
+        objs.push_back(owner.pool.allocate(i));
+        auto address { reinterpret_cast<std::byte*>(objs.back()) };
+        ASSERT_GE(address, reinterpret_cast<std::byte*>(&owner));
+        ASSERT_LT(address, reinterpret_cast<std::byte*>(&owner) + sizeof(Owner));
+    }
+    ASSERT_DEATH(owner.pool.allocate(8), "Memory pool out of space.");
+
+    owner.pool.deallocate(objs[3]);
+    ASSERT_EQ(owner.pool.allocate(9), objs[3]);
+    ASSERT_EQ(objs[3]->getValue(), 9);
+}
+
+TEST(MemPoolTests, CacheAlignedElements) {
+    MemPool<TestObj, 4, HeapMemory, true> pool;
+    static_assert(sizeof(pool) >= 4 * CACHE_LINE_SIZE);
+
+    auto first { pool.allocate(1) };
+    auto second { pool.allocate(2) };
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(first) % CACHE_LINE_SIZE, 0);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(second) % CACHE_LINE_SIZE, 0);
+    ASSERT_NE(reinterpret_cast<uintptr_t>(first) / CACHE_LINE_SIZE, reinterpret_cast<uintptr_t>(second) / CACHE_LINE_SIZE);
+
+    MemPool<TestObj, DYNAMIC_CAPACITY, HeapMemory, true> dynamic_pool { 4 };
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(dynamic_pool.allocate(3)) % CACHE_LINE_SIZE, 0);
+}
+
+TEST(MemPoolTests, HandleRoundTrip) {
+    MemPool pool { MemPool<TestObj>{ 4 } };
+#ifdef NDEBUG
+    static_assert(sizeof(Handle<TestObj>) == 4);
+#endif
+
+    Handle<TestObj> none;
+    ASSERT_FALSE(none.valid());
+
+    pool.allocate(1);
+    TestObj* obj { pool.allocate(2) };
+    auto handle { pool.handleOf(obj) };
+    ASSERT_TRUE(handle.valid());
+    ASSERT_EQ(handle.index(), 1);
+    ASSERT_EQ(pool.get(handle), obj);
+    ASSERT_EQ(pool.get(handle)->getValue(), 2);
+    ASSERT_EQ(pool.handleOf(obj), handle);
+
+    pool.deallocate(handle);
+    ASSERT_EQ(pool.allocate(3), obj);
+}
+
+#ifndef NDEBUG
+TEST(MemPoolTests, StaleHandleDetected) {
+    MemPool<TestObj, 4> pool;
+    TestObj* obj { pool.allocate(1) };
+    auto handle { pool.handleOf(obj) };
+    pool.deallocate(obj);
+
+    ASSERT_DEATH(pool.get(handle), "Handle refers to an element that has been deallocated.");
+    ASSERT_DEATH(pool.handleOf(obj), "Handle requested for unallocated entry in pool.");
+
+    // Same block, new object: the old handle is still stale
+    ASSERT_EQ(pool.allocate(2), obj);
+    ASSERT_DEATH(pool.get(handle), "Handle refers to an element that has been deallocated.");
+    ASSERT_EQ(pool.get(pool.handleOf(obj))->getValue(), 2);
+}
+#endif
@@ -0,0 +1,76 @@
+#include "utils/mempool/slab_allocator.hpp"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <vector>
+
+using namespace utils;
+
+namespace {
+    struct Tracked {
+        static inline int live { 0 };
+        long id;
+        explicit Tracked(long id)
+            : id { id }
+        {
+            ++live;
+        }
+        ~Tracked() { --live; }
+    };
+}
+
+TEST(SlabAllocatorTests, SizesShareClassBlocks) {
+    SlabAllocator<PowerOfTwoSizeClasses<16, 4096>, HeapMemory> slab { 64 * 1024 };
+
+    // 20 bytes rounds up to the 32 byte class, so a freed block is reused for anything from 17 to 32 bytes
+    auto block { slab.allocate(20) };
+    slab.deallocate(block, 20);
+    ASSERT_EQ(slab.allocate(32), block);
+    slab.deallocate(block, 32);
+    ASSERT_NE(slab.allocate(33), block);
+    ASSERT_NE(slab.allocate(16), block);
+    ASSERT_EQ(slab.allocate(17), block);
+}
+
+TEST(SlabAllocatorTests, TunedSizeClasses) {
+    SlabAllocator<SizeClasses<48, 208>, HeapMemory> slab { 4096 };
+    ASSERT_EQ(slab.MAX_SIZE, 208);
+
+    auto small { static_cast<std::byte*>(slab.allocate(1)) };
+    auto large { static_cast<std::byte*>(slab.allocate(49)) };
+    ASSERT_EQ(large - small, 48);
+    ASSERT_DEATH(slab.allocate(209), "Allocation too large for slab allocator size classes.");
+}
+
+TEST(SlabAllocatorTests, BlocksAlignedAndDistinct) {
+    SlabAllocator<PowerOfTwoSizeClasses<16, 1024>, HeapMemory> slab { 8192 };
+    std::set<void*> blocks;
+    for (size_t i = 0; i < 2000; ++i) {
+        const auto size { 1 + i % 1024 };
+        auto block { slab.allocate(size) };
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(block) % alignof(std::max_align_t), 0);
+        std::memset(block, 0xAB, size);
+        ASSERT_TRUE(blocks.insert(block).second);
+    }
+    // Carved more than one arena's worth, so had to grow
+    ASSERT_GT(slab.arenas(), 1);
+}
+
+TEST(SlabAllocatorTests, CreateAndDestroy) {
+    SlabAllocator<> slab;
+    std::vector<Tracked*> objs;
+    for (long i = 0; i < 100; ++i) {
+        objs.push_back(slab.create<Tracked>(i));
+    }
+    ASSERT_EQ(Tracked::live, 100);
+    for (long i = 0; i < 100; ++i) {
+        ASSERT_EQ(objs[i]->id, i);
+        slab.destroy(objs[i]);
+    }
+    ASSERT_EQ(Tracked::live, 0);
+
+    // Most recently freed block comes back first
+    ASSERT_EQ(slab.create<Tracked>(100), objs.back());
+    ASSERT_EQ(slab.arenas(), 1);
+}